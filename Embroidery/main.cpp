@@ -3,16 +3,40 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <ctime>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <cstdlib>
+#include <thread>
+#include <cstring>
+#include <type_traits>
+#include <cstdio>
+#include <string_view>
+#include <tuple>
+#include <filesystem>
+#include <mutex>
+#include <deque>
+#include <climits>
+#include <cerrno>
 
 using namespace std;
 
 // Constants
 const int MAX_SESSIONS = 5;
-const double MIN_HOURS_GOOD = 5.0;
-const double MAX_COST_GOOD = 50.0;
+constexpr double MIN_HOURS_GOOD = 5.0;
+constexpr double MAX_COST_GOOD = 50.0;
 const int EASY_VALUE = 1;
 const int INTERMEDIATE_VALUE = 2;
 const int HARD_VALUE = 3;
+const long long SECONDS_PER_DAY = 86400;
+const long long SECONDS_PER_WEEK = 7 * SECONDS_PER_DAY;
+const int SEGMENT_SIZE = 1024;
+const int TOP_K = 5;
 
 // Enum
 enum DifficultyLevel {
@@ -27,6 +51,8 @@ struct Session {
 	double hours = 0;
 	double cost = 0;
 	DifficultyLevel difficulty = EASY;
+	long long timestamp = 0; // seconds since epoch
+	int projectId = -1;      // catalog project this session was spent on, -1 for none
 };
 
 // Enum Decision Logic (testing)
@@ -39,6 +65,346 @@ string difficultyToString(DifficultyLevel d) {
 	}
 }
 
+// Reverse of difficultyToString; false for anything else
+bool stringToDifficulty(const string& text, DifficultyLevel& d) {
+	if (text == "Easy") d = EASY;
+	else if (text == "Intermediate") d = INTERMEDIATE;
+	else if (text == "Hard") d = HARD;
+	else return false;
+	return true;
+}
+
+// Output Buffer- growable text buffer written out in one go
+// Formatting appends here instead of going through cout, so a whole listing
+// can be built without flushes and then sent to a stream, file or socket.
+class OutputBuffer {
+private:
+	vector<char> bytes;
+
+public:
+	OutputBuffer& append(const char* text, size_t length) {
+		bytes.insert(bytes.end(), text, text + length);
+		return *this;
+	}
+
+	OutputBuffer& append(const char* text) { return append(text, strlen(text)); }
+	OutputBuffer& append(const string& text) { return append(text.data(), text.size()); }
+
+	OutputBuffer& append(char c) {
+		bytes.push_back(c);
+		return *this;
+	}
+
+	OutputBuffer& appendInt(long long value) {
+		char digits[24];
+		int n = 0;
+		unsigned long long v = (value < 0) ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+		do {
+			digits[n++] = (char)('0' + v % 10);
+			v /= 10;
+		} while (v > 0);
+		if (value < 0) bytes.push_back('-');
+		while (n > 0) bytes.push_back(digits[--n]);
+		return *this;
+	}
+
+	// Same text as 'fixed << setprecision(precision)'
+	OutputBuffer& appendFixed(double value, int precision) {
+		char text[64];
+		int n = snprintf(text, sizeof(text), "%.*f", precision, value);
+		if (n > 0) append(text, min((size_t)n, sizeof(text) - 1));
+		return *this;
+	}
+
+	// Replaces already-written bytes, e.g. a length filled in afterwards
+	void overwrite(size_t offset, const char* data, size_t length) {
+		copy(data, data + length, bytes.begin() + offset);
+	}
+
+	const char* data() const { return bytes.data(); }
+	size_t size() const { return bytes.size(); }
+	string str() const { return string(bytes.begin(), bytes.end()); }
+	void clear() { bytes.clear(); }
+
+	bool writeTo(ostream& out) const {
+		out.write(bytes.data(), (streamsize)bytes.size());
+		return (bool)out;
+	}
+
+	bool writeTo(FILE* file) const {
+		return fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	}
+
+	// For any other sink, e.g. a socket: writer(data, length) returns bytes written or < 0
+	template <typename Writer>
+	bool writeWith(Writer writer) const {
+		size_t sent = 0;
+		while (sent < bytes.size()) {
+			long long n = (long long)writer(bytes.data() + sent, bytes.size() - sent);
+			if (n <= 0) return false;
+			sent += (size_t)n;
+		}
+		return true;
+	}
+};
+
+// Field Descriptors- one table per type drives every output format
+// A table is a constexpr tuple of fields. The helpers below expand it at
+// compile time into straight-line code, one call per field, picking the
+// right overload for each member's type.
+// Field ids in the binary catalog format; never reuse a number
+enum FieldId : unsigned char {
+	FIELD_NONE = 0, // not stored in catalogs
+	FIELD_NAME = 1,
+	FIELD_DURATION = 2,
+	FIELD_DIFFICULTY = 3,
+	FIELD_COST = 4,
+	FIELD_STITCH_COUNT = 5,
+	FIELD_CLIENT_NAME = 6
+};
+
+template <typename T, typename M>
+struct FieldDescriptor {
+	const char* label;
+	M T::*member;
+	int width;     // column width in text tables
+	int precision; // digits after the point for doubles
+	FieldId id;
+};
+
+template <typename T, typename M>
+constexpr FieldDescriptor<T, M> makeField(const char* label, M T::*member, int width = 0, int precision = 0, FieldId id = FIELD_NONE) {
+	return FieldDescriptor<T, M>{ label, member, width, precision, id };
+}
+
+template <typename Fields, typename Func>
+void forEachField(const Fields& fields, Func f) {
+	apply([&](const auto&... field) { (f(field), ...); }, fields);
+}
+
+// Text columns
+void writeColumn(ostream& out, const string& v, int width, int) { out << left << setw(width) << v; }
+void writeColumn(ostream& out, double v, int width, int precision) { out << left << setw(width) << fixed << setprecision(precision) << v; }
+void writeColumn(ostream& out, int v, int width, int) { out << left << setw(width) << v; }
+void writeColumn(ostream& out, long long v, int width, int) { out << left << setw(width) << v; }
+void writeColumn(ostream& out, DifficultyLevel v, int width, int) { out << left << setw(width) << difficultyToString(v); }
+
+// "Label: value" text
+void appendValue(OutputBuffer& out, const string& v, int) { out.append(v); }
+void appendValue(OutputBuffer& out, double v, int precision) { out.appendFixed(v, precision); }
+void appendValue(OutputBuffer& out, int v, int) { out.appendInt(v); }
+void appendValue(OutputBuffer& out, long long v, int) { out.appendInt(v); }
+void appendValue(OutputBuffer& out, DifficultyLevel v, int) { out.append(difficultyToString(v)); }
+
+// Parsing trimmed text back into a value
+bool parseValue(const string& text, string& v) { v = text; return true; }
+bool parseValue(const string& text, DifficultyLevel& v) { return stringToDifficulty(text, v); }
+
+bool parseValue(const string& text, double& v) {
+	char* end = nullptr;
+	v = strtod(text.c_str(), &end);
+	return !text.empty() && *end == '\0';
+}
+
+bool parseValue(const string& text, long long& v) {
+	char* end = nullptr;
+	errno = 0;
+	v = strtoll(text.c_str(), &end, 10);
+	return !text.empty() && *end == '\0' && errno != ERANGE;
+}
+
+bool parseValue(const string& text, int& v) {
+	long long wide;
+	if (!parseValue(text, wide) || wide < INT_MIN || wide > INT_MAX) return false;
+	v = (int)wide;
+	return true;
+}
+
+// Binary values, little-endian
+void encodeValue(OutputBuffer& out, unsigned long long bits, int bytes) {
+	for (int i = 0; i < bytes; i++) out.append((char)((bits >> (8 * i)) & 0xFF));
+}
+
+void encodeValue(OutputBuffer& out, const string& v) {
+	encodeValue(out, (unsigned long long)v.size(), 4);
+	out.append(v);
+}
+
+void encodeValue(OutputBuffer& out, double v) {
+	unsigned long long bits;
+	memcpy(&bits, &v, sizeof(bits));
+	encodeValue(out, bits, 8);
+}
+
+void encodeValue(OutputBuffer& out, int v) { encodeValue(out, (unsigned long long)(unsigned int)v, 4); }
+void encodeValue(OutputBuffer& out, long long v) { encodeValue(out, (unsigned long long)v, 8); }
+void encodeValue(OutputBuffer& out, DifficultyLevel v) { encodeValue(out, (unsigned long long)v, 1); }
+void encodeValue(OutputBuffer& out, bool v) { encodeValue(out, (unsigned long long)v, 1); }
+
+bool decodeBits(const char*& p, const char* end, int bytes, unsigned long long& bits) {
+	if (end - p < bytes) return false;
+	bits = 0;
+	for (int i = 0; i < bytes; i++)
+		bits |= (unsigned long long)(unsigned char)p[i] << (8 * i);
+	p += bytes;
+	return true;
+}
+
+bool decodeValue(const char*& p, const char* end, string& v) {
+	unsigned long long length;
+	if (!decodeBits(p, end, 4, length) || (unsigned long long)(end - p) < length) return false;
+	v.assign(p, (size_t)length);
+	p += length;
+	return true;
+}
+
+bool decodeValue(const char*& p, const char* end, double& v) {
+	unsigned long long bits;
+	if (!decodeBits(p, end, 8, bits)) return false;
+	memcpy(&v, &bits, sizeof(v));
+	return true;
+}
+
+bool decodeValue(const char*& p, const char* end, int& v) {
+	unsigned long long bits;
+	if (!decodeBits(p, end, 4, bits)) return false;
+	v = (int)(unsigned int)bits;
+	return true;
+}
+
+bool decodeValue(const char*& p, const char* end, long long& v) {
+	unsigned long long bits;
+	if (!decodeBits(p, end, 8, bits)) return false;
+	v = (long long)bits;
+	return true;
+}
+
+// Only EASY..HARD; anything else is a damaged or newer value
+bool decodeValue(const char*& p, const char* end, DifficultyLevel& v) {
+	unsigned long long bits;
+	if (!decodeBits(p, end, 1, bits) || bits < EASY || bits > HARD) return false;
+	v = (DifficultyLevel)bits;
+	return true;
+}
+
+bool decodeValue(const char*& p, const char* end, bool& v) {
+	unsigned long long bits;
+	if (!decodeBits(p, end, 1, bits)) return false;
+	v = bits != 0;
+	return true;
+}
+
+// Generated formats
+template <typename Fields>
+void writeHeader(ostream& out, const Fields& fields) {
+	forEachField(fields, [&](const auto& f) { out << left << setw(f.width) << f.label; });
+	out << endl;
+}
+
+template <typename T, typename Fields>
+void writeRow(ostream& out, const T& obj, const Fields& fields) {
+	forEachField(fields, [&](const auto& f) { writeColumn(out, obj.*(f.member), f.width, f.precision); });
+	out << endl;
+}
+
+// Name: value, Name: value, ...
+template <typename T, typename Fields>
+void formatLabeled(OutputBuffer& out, const T& obj, const Fields& fields) {
+	bool first = true;
+	forEachField(fields, [&](const auto& f) {
+		if (!first) out.append(", ");
+		first = false;
+		out.append(f.label).append(": ");
+		appendValue(out, obj.*(f.member), f.precision);
+	});
+}
+
+// Reads a line written by writeRow; the last column takes the rest of the line
+template <typename T, typename Fields>
+bool parseRow(const string& line, T& obj, const Fields& fields) {
+	const size_t count = tuple_size<Fields>::value;
+	size_t pos = 0, index = 0;
+	bool ok = true;
+	forEachField(fields, [&](const auto& f) {
+		size_t length = (++index == count) ? string::npos : (size_t)f.width;
+		string text = (pos < line.size()) ? line.substr(pos, length) : "";
+		pos += f.width;
+		size_t last = text.find_last_not_of(' ');
+		text = (last == string::npos) ? "" : text.substr(0, last + 1);
+		ok = parseValue(text, obj.*(f.member)) && ok;
+	});
+	return ok;
+}
+
+template <typename T, typename Fields>
+void encodeFields(OutputBuffer& out, const T& obj, const Fields& fields) {
+	forEachField(fields, [&](const auto& f) { encodeValue(out, obj.*(f.member)); });
+}
+
+template <typename T, typename Fields>
+bool decodeFields(const char*& p, const char* end, T& obj, const Fields& fields) {
+	bool ok = true;
+	forEachField(fields, [&](const auto& f) { ok = ok && decodeValue(p, end, obj.*(f.member)); });
+	return ok;
+}
+
+// Tagged fields: u8 id, u32 length, payload. Strings are stored without
+// their own length prefix since the field length already gives it.
+template <typename V>
+void encodePayload(OutputBuffer& out, const V& v) { encodeValue(out, v); }
+void encodePayload(OutputBuffer& out, const string& v) { out.append(v); }
+
+// False, leaving the value unchanged, for a payload of the wrong size or
+// an invalid value
+template <typename V>
+bool decodePayload(const char* p, size_t length, V& v) {
+	V value = v;
+	const char* q = p;
+	if (!decodeValue(q, p + length, value) || q != p + length) return false;
+	v = value;
+	return true;
+}
+bool decodePayload(const char* p, size_t length, string& v) { v.assign(p, length); return true; }
+bool decodePayload(const char* p, size_t length, string_view& v) { v = string_view(p, length); return true; }
+
+template <typename T, typename Fields>
+void encodeTagged(OutputBuffer& out, const T& obj, const Fields& fields) {
+	forEachField(fields, [&](const auto& f) {
+		if (f.id == FIELD_NONE) return;
+		out.append((char)f.id);
+		size_t lengthAt = out.size();
+		encodeValue(out, 0ULL, 4); // patched once the payload is written
+		encodePayload(out, obj.*(f.member));
+		unsigned long long length = out.size() - lengthAt - 4;
+		char bytes[4];
+		for (int i = 0; i < 4; i++) bytes[i] = (char)((length >> (8 * i)) & 0xFF);
+		out.overwrite(lengthAt, bytes, 4);
+	});
+}
+
+// Fills the member whose id matches; unknown ids are ignored. False when
+// a known field holds a bad payload.
+template <typename T, typename Fields>
+bool decodeTagged(FieldId id, const char* p, size_t length, T& obj, const Fields& fields) {
+	bool ok = true;
+	forEachField(fields, [&](const auto& f) {
+		if (f.id != FIELD_NONE && f.id == id) ok = decodePayload(p, length, obj.*(f.member)) && ok;
+	});
+	return ok;
+}
+
+// Session columns shown in listings and reports
+constexpr auto SESSION_COLUMNS = make_tuple(
+	makeField("Description", &Session::description, 20),
+	makeField("Hours", &Session::hours, 10, 1),
+	makeField("Cost", &Session::cost, 10, 2),
+	makeField("Difficulty", &Session::difficulty, 15));
+
+// Every Session field, for the binary codec
+constexpr auto SESSION_RECORD = tuple_cat(SESSION_COLUMNS, make_tuple(
+	makeField("Timestamp", &Session::timestamp),
+	makeField("Project", &Session::projectId)));
+
 // New Class- Week 4
 class EmbroideryItem {
 protected:
@@ -61,10 +427,23 @@ public:
 	void setDuration(int d) { duration = d; }
 	void setDifficulty(DifficultyLevel d) { difficulty = d; }
 
+	virtual double getCost() const { return 0.0; }
+
+	static constexpr auto fields() {
+		return make_tuple(
+			makeField("Name", &EmbroideryItem::name, 20, 0, FIELD_NAME),
+			makeField("Duration", &EmbroideryItem::duration, 10, 0, FIELD_DURATION),
+			makeField("Difficulty", &EmbroideryItem::difficulty, 15, 0, FIELD_DIFFICULTY));
+	}
+
+	virtual void format(OutputBuffer& out) const {
+		formatLabeled(out, *this, fields());
+	}
+
 	virtual void print() const {
-		cout << "Name: " << name
-			<< ", Duration: " << duration
-			<< ", Difficulty: " << difficultyToString(difficulty);
+		OutputBuffer out;
+		format(out);
+		out.writeTo(cout);
 	}
 
 	virtual ~EmbroideryItem() {}
@@ -93,6 +472,10 @@ public:
 	}
 };
 
+void writeColumn(ostream& out, const CostInfo& v, int width, int) { out << left << setw(width) << v.formattedCost(); }
+void appendValue(OutputBuffer& out, const CostInfo& v, int) { out.append('$').appendFixed(v.getCost(), 2); }
+void encodeValue(OutputBuffer& out, const CostInfo& v) { encodeValue(out, v.getCost()); }
+
 // Derived Class 1- Week 4
 class PracticeProject : public EmbroideryItem {
 private: 
@@ -107,11 +490,19 @@ public:
 	int getStitchCount() const { return stitchCount; }
 	void setStitchCount(int s) { stitchCount = s; }
 
-	void print() const override {
-		EmbroideryItem::print();
-		cout << ", Stitches: " << stitchCount
-			<< ", Cost: " << costInfo.formattedCost()
-			<< endl;
+	const CostInfo& getCostInfo() const { return costInfo; }
+	double getCost() const override { return costInfo.getCost(); }
+	void setCost(double c) { costInfo.setCost(c); }
+
+	static constexpr auto fields() {
+		return tuple_cat(EmbroideryItem::fields(), make_tuple(
+			makeField("Stitches", &PracticeProject::stitchCount, 10, 0, FIELD_STITCH_COUNT),
+			makeField("Cost", &PracticeProject::costInfo, 10, 0, FIELD_COST)));
+	}
+
+	void format(OutputBuffer& out) const override {
+		formatLabeled(out, *this, fields());
+		out.append('\n');
 	}
 };
 
@@ -134,288 +525,5639 @@ public:
 	string getClientName() const { return clientName; }
 	void setClientName(string c) { clientName = c; }
 
-	void print() const override {
-		EmbroideryItem::print();
-		cout << ", Client: " << clientName
-			<< ", Cost: " << costInfo.formattedCost()
-			<< endl;
+	const CostInfo& getCostInfo() const { return costInfo; }
+	double getCost() const override { return costInfo.getCost(); }
+	void setCost(double c) { costInfo.setCost(c); }
+
+	static constexpr auto fields() {
+		return tuple_cat(EmbroideryItem::fields(), make_tuple(
+			makeField("Client", &CommissionProject::clientName, 20, 0, FIELD_CLIENT_NAME),
+			makeField("Cost", &CommissionProject::costInfo, 10, 0, FIELD_COST)));
+	}
+
+	void format(OutputBuffer& out) const override {
+		formatLabeled(out, *this, fields());
+		out.append('\n');
 	}
 };
 
-// New Class- Week 2
-class EmbroideryTracker {
-private: 
-	Session sessions[MAX_SESSIONS];
+// Client Registry- interns client names as small integer ids
+class ClientRegistry {
+private:
+	unordered_map<string, int> ids;
+	vector<string> names;
 
 public:
-	int numSessions = 0;
-
-	EmbroideryTracker() {}
-
-	EmbroideryTracker(Session s[], int numElements) {
-		for (int i = 0; i < numElements; ++i) {
-			addSession(s[i]);
-		}
+	int intern(const string& name) {
+		auto it = ids.find(name);
+		if (it != ids.end()) return it->second;
+		int id = (int)names.size();
+		ids[name] = id;
+		names.push_back(name);
+		return id;
 	}
 
-	bool addSession(Session& s) {
-		if (numSessions >= MAX_SESSIONS || s.hours < 0 || s.cost < 0)
-			return false;
-		sessions[numSessions++] = s;
-		return true;
+	// -1 when the client is unknown
+	int find(const string& name) const {
+		auto it = ids.find(name);
+		return (it == ids.end()) ? -1 : it->second;
 	}
 
-	int getSessionCount() {
-		return numSessions;
-	}
+	const string& getName(int id) const { return names[id]; }
+	int size() const { return (int)names.size(); }
+};
 
-	double calculateTotalHours() {
-		double total = 0.0;
-		for (int i = 0; i < numSessions; i++)
-			total += sessions[i].hours;
+// Project Reference- which array a project lives in and where
+enum ProjectType { PRACTICE_PROJECT, COMMISSION_PROJECT };
 
-		return total;
+struct ProjectRef {
+	ProjectType type = PRACTICE_PROJECT;
+	int index = 0;
+
+	bool operator==(const ProjectRef& other) const {
+		return type == other.type && index == other.index;
 	}
+};
 
-	double getAverageHours() {
-		if (numSessions == 0) return 0.0;
-		return calculateTotalHours() / numSessions;
+// Totals for one project type
+struct ProjectTypeTotals {
+	int count = 0;
+	double cost = 0.0;
+	long long duration = 0;
+	long long stitches = 0; // practice projects only
+};
+
+struct CatalogTotals {
+	ProjectTypeTotals practice;
+	ProjectTypeTotals commission;
+
+	ProjectTypeTotals overall() const {
+		ProjectTypeTotals t;
+		t.count = practice.count + commission.count;
+		t.cost = practice.cost + commission.cost;
+		t.duration = practice.duration + commission.duration;
+		t.stitches = practice.stitches + commission.stitches;
+		return t;
 	}
+};
 
-	void fillSession() {
+// Project Catalog- each project type in its own contiguous array
+// Projects are stored by value, so loops over the catalog know the exact
+// type and call members directly instead of going through the vtable.
+// Lookups by difficulty, name and client are kept up to date on add.
+class ProjectCatalog {
+private:
+	vector<PracticeProject> practiceProjects;
+	vector<CommissionProject> commissionProjects;
 
-		Session s;
-		s.description = getNonEmptyString("Session description : ");
-		s.hours = getPositiveDouble("Hours spent: ");
-		s.cost = getPositiveDouble("Thread cost: ");
-		s.difficulty = getDifficulty();
-		addSession(s);
+	vector<ProjectRef> projectsById; // catalog-wide project ids
+	vector<ProjectRef> byDifficulty[HARD_VALUE + 1];
+	unordered_map<string, vector<ProjectRef>> byName;
+	ClientRegistry clients;
+	vector<int> commissionClientIds;    // parallel to commissionProjects
+	vector<vector<int>> projectsByClient; // commission indexes per client id
+
+	void index(const EmbroideryItem& item, ProjectRef ref) {
+		if (item.getDifficulty() >= EASY && item.getDifficulty() <= HARD)
+			byDifficulty[item.getDifficulty()].push_back(ref);
+		byName[item.getName()].push_back(ref);
 	}
 
-	DifficultyLevel getHardestDifficulty() {
-		DifficultyLevel hardest = EASY;
-		for (int i = 0; i < numSessions; i++) {
-			if (sessions[i].difficulty > hardest)
-				hardest = sessions[i].difficulty;
-		}
-		return hardest;
+public:
+	// Returns the new project's id
+	int add(const PracticeProject& p) {
+		ProjectRef ref = { PRACTICE_PROJECT, (int)practiceProjects.size() };
+		practiceProjects.push_back(p);
+		index(p, ref);
+		projectsById.push_back(ref);
+		return (int)projectsById.size() - 1;
 	}
-	
-	void showBanner() {
-		cout << "=========================\n";
-		cout << "    Embroidery Tracker   \n";
-		cout << "=========================\n\n";
+
+	int add(const CommissionProject& c) {
+		ProjectRef ref = { COMMISSION_PROJECT, (int)commissionProjects.size() };
+		commissionProjects.push_back(c);
+		index(c, ref);
+		projectsById.push_back(ref);
+
+		int clientId = clients.intern(c.getClientName());
+		if (clientId == (int)projectsByClient.size())
+			projectsByClient.push_back(vector<int>());
+		projectsByClient[clientId].push_back(ref.index);
+		commissionClientIds.push_back(clientId);
+		return (int)projectsById.size() - 1;
 	}
 
-	void printAllSessions() {
-		for (int i = 0; i < numSessions; i++) {
-			printSession(i);
-		}
+	ProjectRef getRef(int projectId) const { return projectsById[projectId]; }
+	const EmbroideryItem& getById(int projectId) const { return get(projectsById[projectId]); }
+
+	const EmbroideryItem& get(ProjectRef ref) const {
+		if (ref.type == PRACTICE_PROJECT) return practiceProjects[ref.index];
+		return commissionProjects[ref.index];
 	}
 
-	void printSession(int sessionNum) {
-		Session s = sessions[sessionNum];
+	const vector<ProjectRef>& withDifficulty(DifficultyLevel d) const {
+		static const vector<ProjectRef> none;
+		return (d >= EASY && d <= HARD) ? byDifficulty[d] : none;
+	}
 
-		cout << left << setw(20) << s.description
-			<< setw(10) << fixed << setprecision(1) << s.hours
-			<< setw(10) << fixed << setprecision(2) << s.cost
-			<< setw(15) << difficultyToString(s.difficulty) << endl;
+	const vector<ProjectRef>& withName(const string& name) const {
+		static const vector<ProjectRef> none;
+		auto it = byName.find(name);
+		return (it == byName.end()) ? none : it->second;
 	}
 
-	void saveReport(string& name, double goal) {
-		ofstream outFile("report.txt");
+	const vector<int>& forClient(const string& client) const {
+		static const vector<int> none;
+		int id = clients.find(client);
+		return (id < 0) ? none : projectsByClient[id];
+	}
 
-		outFile << "Embroidery Report for " << name << endl;
-		outFile << "Weekly Hour Goal: " << fixed << setprecision(1) << goal << "\n\n";
+	const ClientRegistry& getClients() const { return clients; }
+	const vector<int>& getCommissionClientIds() const { return commissionClientIds; }
 
-		for (int i = 0; i < numSessions; i++) {
-			outFile << left << setw(20) << sessions[i].description
-				<< setw(10) << fixed << setprecision(1) << sessions[i].hours
-				<< setw(10) << fixed << setprecision(2) << sessions[i].cost
-				<< setw(15) << difficultyToString(sessions[i].difficulty) << endl;
+	// Count, cost, duration and stitches per type, one pass over each array
+	CatalogTotals computeTotals() const {
+		CatalogTotals totals;
+		for (const PracticeProject& p : practiceProjects) {
+			totals.practice.count++;
+			totals.practice.cost += p.getCostInfo().getCost();
+			totals.practice.duration += p.getDuration();
+			totals.practice.stitches += p.getStitchCount();
 		}
-
-		outFile.close();
+		for (const CommissionProject& c : commissionProjects) {
+			totals.commission.count++;
+			totals.commission.cost += c.getCostInfo().getCost();
+			totals.commission.duration += c.getDuration();
+		}
+		return totals;
 	}
 
-	string getNonEmptyString(string prompt) {
-		string input;
-		do {
-			cout << prompt;
-			getline(cin >> ws, input);
-		} while (input.empty());
-		return input;
+	// Totals for a subset, e.g. the result of withDifficulty()
+	CatalogTotals computeTotals(const vector<ProjectRef>& refs) const {
+		CatalogTotals totals;
+		for (ProjectRef ref : refs) {
+			if (ref.type == PRACTICE_PROJECT) {
+				const PracticeProject& p = practiceProjects[ref.index];
+				totals.practice.count++;
+				totals.practice.cost += p.getCostInfo().getCost();
+				totals.practice.duration += p.getDuration();
+				totals.practice.stitches += p.getStitchCount();
+			}
+			else {
+				const CommissionProject& c = commissionProjects[ref.index];
+				totals.commission.count++;
+				totals.commission.cost += c.getCostInfo().getCost();
+				totals.commission.duration += c.getDuration();
+			}
+		}
+		return totals;
 	}
 
-	double getPositiveDouble(string prompt) {
-		double value;
-		do {
-			cout << prompt;
-			cin >> value;
+	int size() const { return (int)(practiceProjects.size() + commissionProjects.size()); }
 
-			if (cin.fail() || value <= 0) {
-				cin.clear();
-				cin.ignore(1000, '\n');
-				cout << "Please enter a positive number.\n";
-			}
-		} while (value <= 0);
+	const vector<PracticeProject>& getPracticeProjects() const { return practiceProjects; }
+	const vector<CommissionProject>& getCommissionProjects() const { return commissionProjects; }
 
-		return value;
+	// f is called with the concrete type, e.g. a generic lambda
+	template <typename Func>
+	void forEach(Func f) const {
+		for (const PracticeProject& p : practiceProjects) f(p);
+		for (const CommissionProject& c : commissionProjects) f(c);
 	}
 
-	DifficultyLevel getDifficulty() {
-		int choice;
-		cout << "Select difficulty (1 = Easy, 2 = Intermediate, 3 = Hard): ";
-		cin >> choice;
+	double totalCost() const {
+		double total = 0.0;
+		for (const PracticeProject& p : practiceProjects) total += p.PracticeProject::getCost();
+		for (const CommissionProject& c : commissionProjects) total += c.CommissionProject::getCost();
+		return total;
+	}
 
-		switch (choice) {
-		case EASY_VALUE: return EASY;
-		case INTERMEDIATE_VALUE: return INTERMEDIATE;
-		case HARD_VALUE: return HARD;
-		default:
-			cout << "Invalid choice. Defaulting to 'Easy'.\n";
-			return EASY;
-		}
+	long long totalDuration() const {
+		long long total = 0;
+		forEach([&](const EmbroideryItem& item) { total += item.getDuration(); });
+		return total;
 	}
 
-	void showMenu() {
-		cout << "\nMenu:\n";
-		cout << "1. Add embroidery session.\n";
-		cout << "2. View Sessions\n";
-		cout << "3. Get recommendation\n";
-		cout << "4. Save report\n";
-		cout << "5. Quit\n";
-		cout << "Enter your choice: ";
+	void writeListing(OutputBuffer& out) const {
+		for (const PracticeProject& p : practiceProjects) p.PracticeProject::format(out);
+		for (const CommissionProject& c : commissionProjects) c.CommissionProject::format(out);
 	}
 
-	// Calculation Logic (testing)
-	double calculateTotalCost() {
-		double total = 0.0;
-		for (int i = 0; i < numSessions; i++)
-			total += sessions[i].cost;
-		return total;
+	void printAll() const {
+		OutputBuffer out;
+		writeListing(out);
+		out.writeTo(cout);
+	}
+
+	bool saveListing(const string& filename) const {
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (!file) return false;
+		OutputBuffer out;
+		writeListing(out);
+		bool ok = out.writeTo(file);
+		return fclose(file) == 0 && ok;
 	}
 };
 
-#ifdef RUN_TESTS
-#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
-#include "doctest.h"
+// Binary Catalog Format
+// Header: "EMBR", u16 schema version, u16 reserved, u32 record count.
+// Record: u8 record type, u32 body length, then fields. Each field is
+// u8 field id, u32 length, payload. Readers skip unknown record types and
+// unknown fields, so new fields can be added without breaking old files.
+// All integers are little-endian.
+const unsigned short CATALOG_SCHEMA_VERSION = 1;
 
-// DOCTEST
+enum RecordType : unsigned char {
+	RECORD_ITEM = 1,
+	RECORD_PRACTICE = 2,
+	RECORD_COMMISSION = 3
+};
 
-TEST_CASE("Calculations - totals") {
-	Session s[2] = {
-		{"A", 2.5, 10.0, EASY},
-		{"B", 3.5, 20.0, HARD},
-	};
-	EmbroideryTracker tracker = EmbroideryTracker(s, 2);
+// Project fields as read from a buffer; strings point into the buffer
+struct ProjectView {
+	RecordType type = RECORD_ITEM;
+	string_view name;
+	int duration = 0;
+	DifficultyLevel difficulty = EASY;
+	double cost = 0.0;
+	int stitchCount = 0;
+	string_view clientName;
+};
 
-	CHECK(tracker.calculateTotalHours() == doctest::Approx(6.0));
-	CHECK(tracker.calculateTotalCost() == doctest::Approx(30.0));
-	CHECK(tracker.getAverageHours() == doctest::Approx(3.0));
-}
+// Same ids as the item tables, so a view reads what fields() wrote
+constexpr auto PROJECT_VIEW_FIELDS = make_tuple(
+	makeField("Name", &ProjectView::name, 0, 0, FIELD_NAME),
+	makeField("Duration", &ProjectView::duration, 0, 0, FIELD_DURATION),
+	makeField("Difficulty", &ProjectView::difficulty, 0, 0, FIELD_DIFFICULTY),
+	makeField("Cost", &ProjectView::cost, 0, 0, FIELD_COST),
+	makeField("Stitches", &ProjectView::stitchCount, 0, 0, FIELD_STITCH_COUNT),
+	makeField("Client", &ProjectView::clientName, 0, 0, FIELD_CLIENT_NAME));
 
-TEST_CASE("Calculation edge case - no sessions") {
-	EmbroideryTracker tracker = EmbroideryTracker();
+// Records are generated from each class's fields() table
+class CatalogWriter {
+private:
+	OutputBuffer& out;
+	size_t recordStart = 0;
+	unsigned int records = 0;
+	size_t countOffset = 0;
 
-	CHECK(tracker.calculateTotalHours() == 0.0);
-	CHECK(tracker.calculateTotalCost() == 0.0);
-}
+	void patchU32(size_t offset, unsigned int v) {
+		char bytes[4];
+		for (int i = 0; i < 4; i++) bytes[i] = (char)((v >> (8 * i)) & 0xFF);
+		out.overwrite(offset, bytes, 4);
+	}
 
-TEST_CASE("Calculation edge case - empty session") {
-	Session s[1] = { };
-	EmbroideryTracker tracker = EmbroideryTracker(s, 1);
+	template <typename T>
+	void record(RecordType type, const T& item) {
+		out.append((char)type);
+		recordStart = out.size();
+		encodeValue(out, 0ULL, 4); // body length, patched below
+		encodeTagged(out, item, T::fields());
+		patchU32(recordStart, (unsigned int)(out.size() - recordStart - 4));
+		records++;
+		patchU32(countOffset, records);
+	}
 
-	CHECK(tracker.calculateTotalHours() == 0.0);
-	CHECK(tracker.calculateTotalCost() == 0.0);
-}
+public:
+	CatalogWriter(OutputBuffer& buffer) : out(buffer) {
+		out.append("EMBR", 4);
+		encodeValue(out, (unsigned long long)CATALOG_SCHEMA_VERSION, 2);
+		encodeValue(out, 0ULL, 2);
+		countOffset = out.size();
+		encodeValue(out, 0ULL, 4);
+	}
 
-TEST_CASE("Enum decision logic") {
-	CHECK(string(difficultyToString(EASY)) == "Easy");
-	CHECK(string(difficultyToString(INTERMEDIATE)) == "Intermediate");
-	CHECK(string(difficultyToString(HARD)) == "Hard");
+	void write(const EmbroideryItem& item) { record(RECORD_ITEM, item); }
+	void write(const PracticeProject& p) { record(RECORD_PRACTICE, p); }
+	void write(const CommissionProject& c) { record(RECORD_COMMISSION, c); }
 
-	Session s[2] = {
-		{"A", 2.5, 10.0, EASY},
-		{"B", 3.5, 20.0, HARD},
-	};
-	EmbroideryTracker tracker = EmbroideryTracker(s, 2);
-	CHECK(tracker.getHardestDifficulty() == HARD);
-}
+	void write(const ProjectCatalog& catalog) {
+		catalog.forEach([this](const auto& project) { write(project); });
+	}
+};
+
+class CatalogReader {
+private:
+	const char* data;
+	size_t size;
+	size_t pos = 0;
+	unsigned int recordCount = 0;
+	unsigned short version = 0;
+	unsigned int damagedRecords = 0;
+
+	unsigned int getU32(size_t at) const {
+		const char* p = data + at;
+		unsigned long long v = 0;
+		decodeBits(p, data + size, 4, v);
+		return (unsigned int)v;
+	}
+
+public:
+	CatalogReader(const char* bytes, size_t length)
+		: data(bytes), size(length) {}
+
+	// Checks the header; call before next()
+	bool open(string& error) {
+		if (size < 12 || memcmp(data, "EMBR", 4) != 0) {
+			error = "not a catalog file";
+			return false;
+		}
+		// newer versions only add fields and record types, which next() skips
+		const char* p = data + 4;
+		unsigned long long v = 0;
+		decodeBits(p, data + size, 2, v);
+		version = (unsigned short)v;
+		recordCount = getU32(8);
+		pos = 12;
+		return true;
+	}
+
+	unsigned int getRecordCount() const { return recordCount; }
+	unsigned short getVersion() const { return version; }
+	unsigned int getDamagedRecords() const { return damagedRecords; }
+
+	// Reads the next known record; false at the end or on a truncated record.
+	// Records with a bad value in a known field are skipped and counted.
+	bool next(ProjectView& view, string& error) {
+		while (pos < size) {
+			if (size - pos < 5) {
+				error = "truncated record header";
+				return false;
+			}
+			unsigned char type = (unsigned char)data[pos];
+			unsigned int length = getU32(pos + 1);
+			size_t body = pos + 5;
+			if (length > size - body) {
+				error = "truncated record";
+				return false;
+			}
+			pos = body + length;
+			if (type < RECORD_ITEM || type > RECORD_COMMISSION) continue; // newer record type
+
+			view = ProjectView();
+			view.type = (RecordType)type;
+			bool damaged = false;
+			size_t f = body;
+			while (f < body + length) {
+				if (body + length - f < 5) {
+					error = "truncated field";
+					return false;
+				}
+				FieldId id = (FieldId)(unsigned char)data[f];
+				unsigned int n = getU32(f + 1);
+				if (n > body + length - (f + 5)) {
+					error = "truncated field";
+					return false;
+				}
+				// newer fields are skipped
+				damaged = !decodeTagged(id, data + f + 5, n, view, PROJECT_VIEW_FIELDS) || damaged;
+				f += 5 + n;
+			}
+			if (damaged) {
+				damagedRecords++;
+				continue;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// Builds projects from every record; plain items have no place in a catalog and are skipped.
+	// Good records are still added when some are damaged, but the call reports it.
+	bool readInto(ProjectCatalog& catalog, string& error) {
+		ProjectView view;
+		error.clear();
+		while (next(view, error)) {
+			if (view.type == RECORD_PRACTICE)
+				catalog.add(PracticeProject(string(view.name), view.duration, view.difficulty, view.stitchCount, view.cost));
+			else if (view.type == RECORD_COMMISSION)
+				catalog.add(CommissionProject(string(view.name), view.duration, view.difficulty, string(view.clientName), view.cost));
+		}
+		if (error.empty() && damagedRecords > 0)
+			error = to_string(damagedRecords) + " damaged record(s) skipped";
+		return error.empty();
+	}
+};
+
+bool saveCatalog(const ProjectCatalog& catalog, const string& filename) {
+	OutputBuffer out;
+	CatalogWriter writer(out);
+	writer.write(catalog);
+
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (!file) return false;
+	bool ok = out.writeTo(file);
+	return fclose(file) == 0 && ok;
+}
+
+// Whole file in one read; keep 'bytes' alive while using views into it
+bool readFileBytes(const string& filename, vector<char>& bytes) {
+	ifstream inFile(filename, ios::binary | ios::ate);
+	if (!inFile) return false;
+	streamsize length = inFile.tellg();
+	inFile.seekg(0);
+	bytes.resize((size_t)length);
+	return (bool)inFile.read(bytes.data(), length);
+}
+
+bool loadCatalog(const string& filename, ProjectCatalog& catalog, string& error) {
+	vector<char> bytes;
+	if (!readFileBytes(filename, bytes)) {
+		error = "could not read " + filename;
+		return false;
+	}
+	CatalogReader reader(bytes.data(), bytes.size());
+	return reader.open(error) && reader.readInto(catalog, error);
+}
+
+// Pattern Files- machine stitch files read in chunks
+// Two formats are understood:
+//   Tajima DST: a 512-byte text header, then 3-byte records of relative
+//   moves in 0.1 mm units.
+//   Text: one "x y TYPE" record per line with absolute coordinates in
+//   0.1 mm, TYPE being STITCH, JUMP, COLOR or END. Blank lines and lines
+//   starting with '#' are ignored.
+// Chunks can split a record anywhere; the partial record is kept until
+// the rest arrives.
+enum PatternFormat { PATTERN_DST, PATTERN_TEXT };
+
+enum StitchType : unsigned char { STITCH_NORMAL, STITCH_JUMP, STITCH_COLOR, STITCH_END };
+
+const int DST_HEADER_SIZE = 512;
+const int DST_RECORD_SIZE = 3;
+const size_t PATTERN_CHUNK_SIZE = 64 * 1024;
+
+// Library designs below EASY_STITCH_LIMIT stitches are EASY, from
+// HARD_STITCH_LIMIT up they are HARD
+const int EASY_STITCH_LIMIT = 5000;
+const int HARD_STITCH_LIMIT = 15000;
+
+// Picks the format from the file extension
+bool patternFormatFromName(const string& filename, PatternFormat& format) {
+	size_t dot = filename.find_last_of('.');
+	if (dot == string::npos) return false;
+	string ext = filename.substr(dot + 1);
+	for (char& c : ext) c = (char)tolower((unsigned char)c);
+	if (ext == "dst") format = PATTERN_DST;
+	else if (ext == "txt") format = PATTERN_TEXT;
+	else return false;
+	return true;
+}
+
+// Pattern Stats- counts and extents of one design
+struct PatternStats {
+	int stitches = 0;
+	int jumps = 0;
+	int colorChanges = 0;
+	int minX = 0, maxX = 0, minY = 0, maxY = 0; // over stitch positions
+	bool ended = false;
+
+	int colors() const { return stitches > 0 ? colorChanges + 1 : 0; }
+	int width() const { return maxX - minX; }
+	int height() const { return maxY - minY; }
+};
+
+// Stitch Pattern- every needle position, one array per field
+struct StitchPattern {
+	vector<int> xs;
+	vector<int> ys;
+	vector<StitchType> types;
+
+	size_t size() const { return xs.size(); }
+	void add(int x, int y, StitchType type) {
+		xs.push_back(x);
+		ys.push_back(y);
+		types.push_back(type);
+	}
+};
+
+// DST moves split into per-byte lookup tables so a record decodes with
+// three table reads per axis instead of testing twenty bits
+struct DstTables {
+	signed char dx[DST_RECORD_SIZE][256];
+	signed char dy[DST_RECORD_SIZE][256];
+
+	DstTables() {
+		// bit, x step, y step for each byte of a record
+		static const int moves[DST_RECORD_SIZE][8][2] = {
+			{ { 1, 0 }, { -1, 0 }, { 9, 0 }, { -9, 0 }, { 0, -9 }, { 0, 9 }, { 0, -1 }, { 0, 1 } },
+			{ { 3, 0 }, { -3, 0 }, { 27, 0 }, { -27, 0 }, { 0, -27 }, { 0, 27 }, { 0, -3 }, { 0, 3 } },
+			{ { 0, 0 }, { 0, 0 }, { 81, 0 }, { -81, 0 }, { 0, -81 }, { 0, 81 }, { 0, 0 }, { 0, 0 } },
+		};
+		for (int b = 0; b < DST_RECORD_SIZE; b++) {
+			for (int value = 0; value < 256; value++) {
+				int x = 0, y = 0;
+				for (int bit = 0; bit < 8; bit++) {
+					if (value & (1 << bit)) {
+						x += moves[b][bit][0];
+						y += moves[b][bit][1];
+					}
+				}
+				dx[b][value] = (signed char)x;
+				dy[b][value] = (signed char)y;
+			}
+		}
+	}
+};
+
+const DstTables& dstTables() {
+	static const DstTables tables;
+	return tables;
+}
+
+class PatternParser {
+private:
+	PatternFormat format;
+	PatternStats patternStats;
+	StitchPattern* pattern; // optional, receives every record
+	int x = 0, y = 0;
+	int headerLeft = DST_HEADER_SIZE;
+	string partial; // unfinished record or line from the previous chunk
+	int lineNumber = 0;
+	string error;
+
+	void record(StitchType type) {
+		if (type == STITCH_NORMAL) {
+			if (patternStats.stitches == 0) {
+				patternStats.minX = patternStats.maxX = x;
+				patternStats.minY = patternStats.maxY = y;
+			} else {
+				patternStats.minX = min(patternStats.minX, x);
+				patternStats.maxX = max(patternStats.maxX, x);
+				patternStats.minY = min(patternStats.minY, y);
+				patternStats.maxY = max(patternStats.maxY, y);
+			}
+			patternStats.stitches++;
+		} else if (type == STITCH_JUMP) {
+			patternStats.jumps++;
+		} else if (type == STITCH_COLOR) {
+			patternStats.colorChanges++;
+		} else {
+			patternStats.ended = true;
+		}
+		if (pattern) pattern->add(x, y, type);
+	}
+
+	void dstRecord(const unsigned char* r) {
+		if (r[2] == 0xF3) {
+			record(STITCH_END);
+			return;
+		}
+		const DstTables& t = dstTables();
+		x += t.dx[0][r[0]] + t.dx[1][r[1]] + t.dx[2][r[2]];
+		y += t.dy[0][r[0]] + t.dy[1][r[1]] + t.dy[2][r[2]];
+		if ((r[2] & 0xC3) == 0xC3) record(STITCH_COLOR);
+		else if (r[2] & 0x80) record(STITCH_JUMP);
+		else record(STITCH_NORMAL);
+	}
+
+	void feedDst(const char* data, size_t size) {
+		if (headerLeft > 0) {
+			size_t skip = min(size, (size_t)headerLeft);
+			headerLeft -= (int)skip;
+			data += skip;
+			size -= skip;
+		}
+		if (!partial.empty()) {
+			while (size > 0 && partial.size() < (size_t)DST_RECORD_SIZE && !patternStats.ended) {
+				partial += *data++;
+				size--;
+			}
+			if (partial.size() < (size_t)DST_RECORD_SIZE) return;
+			dstRecord((const unsigned char*)partial.data());
+			partial.clear();
+		}
+		const unsigned char* p = (const unsigned char*)data;
+		const unsigned char* end = p + size - size % DST_RECORD_SIZE;
+		for (; p < end && !patternStats.ended; p += DST_RECORD_SIZE)
+			dstRecord(p);
+		if (!patternStats.ended)
+			partial.assign((const char*)end, size % DST_RECORD_SIZE);
+	}
+
+	void textLine(const string& line) {
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == string::npos || line[start] == '#') return;
+
+		const char* p = line.c_str();
+		char* next = nullptr;
+		long nx = strtol(p, &next, 10);
+		bool ok = next != p;
+		p = next;
+		long ny = strtol(p, &next, 10);
+		ok = ok && next != p;
+		while (*next == ' ' || *next == '\t') next++;
+		size_t length = strcspn(next, " \t\r");
+		string type(next, length);
+		if (!ok || type.empty()) {
+			error = "line " + to_string(lineNumber) + ": expected x y TYPE";
+			return;
+		}
+		x = (int)nx;
+		y = (int)ny;
+		if (type == "STITCH") record(STITCH_NORMAL);
+		else if (type == "JUMP") record(STITCH_JUMP);
+		else if (type == "COLOR") record(STITCH_COLOR);
+		else if (type == "END") record(STITCH_END);
+		else error = "line " + to_string(lineNumber) + ": unknown record type " + type;
+	}
+
+	void feedText(const char* data, size_t size) {
+		const char* end = data + size;
+		while (data < end && error.empty() && !patternStats.ended) {
+			const char* newline = (const char*)memchr(data, '\n', end - data);
+			if (!newline) {
+				partial.append(data, end);
+				return;
+			}
+			if (partial.empty()) {
+				textLine(string(data, newline));
+			} else {
+				partial.append(data, newline);
+				textLine(partial);
+				partial.clear();
+			}
+			data = newline + 1;
+		}
+	}
+
+public:
+	explicit PatternParser(PatternFormat f, StitchPattern* out = nullptr)
+		: format(f), pattern(out) {}
+
+	void feed(const char* data, size_t size) {
+		if (!error.empty() || patternStats.ended) return;
+		if (format == PATTERN_DST) feedDst(data, size);
+		else feedText(data, size);
+	}
+
+	// Call once the input is exhausted
+	bool finish(string& message) {
+		if (format == PATTERN_TEXT && error.empty() && !partial.empty() && !patternStats.ended) {
+			textLine(partial);
+			partial.clear();
+		}
+		if (error.empty() && format == PATTERN_DST) {
+			if (headerLeft > 0) error = "file is shorter than the DST header";
+			else if (!partial.empty()) error = "file ends in the middle of a record";
+		}
+		message = error;
+		return error.empty();
+	}
+
+	const PatternStats& stats() const { return patternStats; }
+};
+
+bool parsePatternFile(const string& filename, PatternStats& stats, string& error, StitchPattern* pattern = nullptr) {
+	PatternFormat format;
+	if (!patternFormatFromName(filename, format)) {
+		error = "unknown pattern format: " + filename;
+		return false;
+	}
+	ifstream inFile(filename, ios::binary);
+	if (!inFile) {
+		error = "could not read " + filename;
+		return false;
+	}
+	PatternParser parser(format, pattern);
+	vector<char> chunk(PATTERN_CHUNK_SIZE);
+	while (inFile.read(chunk.data(), chunk.size()) || inFile.gcount() > 0)
+		parser.feed(chunk.data(), (size_t)inFile.gcount());
+	bool ok = parser.finish(error);
+	stats = parser.stats();
+	return ok;
+}
+
+// Stitch count comes from the design instead of being typed in
+void applyPattern(PracticeProject& project, const PatternStats& stats) {
+	project.setStitchCount(stats.stitches);
+}
+
+// Work-Stealing Queue- the owner takes tasks from the back, idle workers
+// steal from the front
+class WorkStealingQueue {
+private:
+	mutex lock;
+	deque<size_t> tasks;
+
+public:
+	void push(size_t task) {
+		lock_guard<mutex> guard(lock);
+		tasks.push_back(task);
+	}
+
+	bool pop(size_t& task) {
+		lock_guard<mutex> guard(lock);
+		if (tasks.empty()) return false;
+		task = tasks.back();
+		tasks.pop_back();
+		return true;
+	}
+
+	bool steal(size_t& task) {
+		lock_guard<mutex> guard(lock);
+		if (tasks.empty()) return false;
+		task = tasks.front();
+		tasks.pop_front();
+		return true;
+	}
+};
+
+// Runs f(i) for every i in [0, count). Tasks are dealt out round-robin and
+// a worker that runs dry steals from the others, so a few very large files
+// do not leave the other threads waiting.
+template <typename Func>
+void runWorkStealing(size_t count, int numThreads, Func f) {
+	if (numThreads <= 0)
+		numThreads = max(1, (int)thread::hardware_concurrency());
+	numThreads = (int)min((size_t)numThreads, max((size_t)1, count));
+
+	vector<WorkStealingQueue> queues(numThreads);
+	for (size_t i = 0; i < count; i++)
+		queues[i % numThreads].push(i);
+
+	auto work = [&](int self) {
+		size_t task;
+		while (true) {
+			bool found = queues[self].pop(task);
+			for (int k = 1; k < numThreads && !found; k++)
+				found = queues[(self + k) % numThreads].steal(task);
+			if (!found) return; // nothing is added once started, so every queue is empty
+			f(task);
+		}
+	};
+
+	vector<thread> workers;
+	for (int t = 1; t < numThreads; t++)
+		workers.emplace_back(work, t);
+	work(0);
+	for (thread& w : workers)
+		w.join();
+}
+
+// FNV-1a over the whole file
+long long hashBytes(const char* data, size_t size) {
+	unsigned long long h = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++) {
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ULL;
+	}
+	return (long long)h;
+}
+
+// Pattern Cache- stats of every analyzed file, keyed by path
+// A file whose size and modification time match its entry is not opened
+// again. If only the time changed, a matching hash still skips the parse.
+struct PatternCacheEntry {
+	string path;
+	long long size = 0;
+	long long modified = 0;
+	long long hash = 0;
+	PatternStats stats;
+};
+
+constexpr auto PATTERN_CACHE_KEY = make_tuple(
+	makeField("Path", &PatternCacheEntry::path),
+	makeField("Size", &PatternCacheEntry::size),
+	makeField("Modified", &PatternCacheEntry::modified),
+	makeField("Hash", &PatternCacheEntry::hash));
+
+constexpr auto PATTERN_STATS_FIELDS = make_tuple(
+	makeField("Stitches", &PatternStats::stitches),
+	makeField("Jumps", &PatternStats::jumps),
+	makeField("Colors", &PatternStats::colorChanges),
+	makeField("MinX", &PatternStats::minX),
+	makeField("MaxX", &PatternStats::maxX),
+	makeField("MinY", &PatternStats::minY),
+	makeField("MaxY", &PatternStats::maxY),
+	makeField("Ended", &PatternStats::ended));
+
+const char PATTERN_CACHE_MAGIC[4] = { 'E', 'M', 'P', 'C' };
+
+class PatternCache {
+private:
+	unordered_map<string, PatternCacheEntry> entries;
+
+public:
+	size_t size() const { return entries.size(); }
+
+	const PatternCacheEntry* find(const string& path) const {
+		auto it = entries.find(path);
+		return it == entries.end() ? nullptr : &it->second;
+	}
+
+	void put(const PatternCacheEntry& entry) { entries[entry.path] = entry; }
+	void clear() { entries.clear(); }
+
+	bool save(const string& filename) const {
+		OutputBuffer out;
+		out.append(string(PATTERN_CACHE_MAGIC, 4));
+		encodeValue(out, (unsigned long long)entries.size(), 4);
+		for (const auto& kv : entries) {
+			encodeFields(out, kv.second, PATTERN_CACHE_KEY);
+			encodeFields(out, kv.second.stats, PATTERN_STATS_FIELDS);
+		}
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (!file) return false;
+		bool ok = out.writeTo(file);
+		return fclose(file) == 0 && ok;
+	}
+
+	// A missing or damaged cache just means every file is parsed again
+	bool load(const string& filename) {
+		entries.clear();
+		vector<char> bytes;
+		if (!readFileBytes(filename, bytes) || bytes.size() < 8 || memcmp(bytes.data(), PATTERN_CACHE_MAGIC, 4) != 0)
+			return false;
+		const char* p = bytes.data() + 4;
+		const char* end = bytes.data() + bytes.size();
+		unsigned long long count = 0;
+		decodeBits(p, end, 4, count);
+		for (unsigned long long i = 0; i < count; i++) {
+			PatternCacheEntry entry;
+			if (!decodeFields(p, end, entry, PATTERN_CACHE_KEY) || !decodeFields(p, end, entry.stats, PATTERN_STATS_FIELDS)) {
+				entries.clear();
+				return false;
+			}
+			entries[entry.path] = entry;
+		}
+		return true;
+	}
+};
+
+// Library Scan- one analyzed file
+struct LibraryEntry {
+	PatternCacheEntry file;
+	bool fromCache = false;
+	string error;
+};
+
+struct LibraryScan {
+	vector<LibraryEntry> entries; // sorted by path
+	int parsed = 0;
+	int cached = 0;
+	int failed = 0;
+};
+
+// Library Analyzer- every pattern file under a directory
+class LibraryAnalyzer {
+private:
+	static void analyzeFile(LibraryEntry& entry, const PatternCache& cache) {
+		PatternCacheEntry& file = entry.file;
+		error_code ec;
+		file.size = (long long)filesystem::file_size(file.path, ec);
+		if (!ec) file.modified = (long long)filesystem::last_write_time(file.path, ec).time_since_epoch().count();
+		if (ec) {
+			entry.error = "could not read " + file.path;
+			return;
+		}
+
+		const PatternCacheEntry* old = cache.find(file.path);
+		if (old && old->size == file.size && old->modified == file.modified) {
+			file.hash = old->hash;
+			file.stats = old->stats;
+			entry.fromCache = true;
+			return;
+		}
+
+		vector<char> bytes;
+		if (!readFileBytes(file.path, bytes)) {
+			entry.error = "could not read " + file.path;
+			return;
+		}
+		file.hash = hashBytes(bytes.data(), bytes.size());
+		if (old && old->size == file.size && old->hash == file.hash) {
+			file.stats = old->stats;
+			entry.fromCache = true;
+			return;
+		}
+
+		PatternFormat format = PATTERN_TEXT;
+		patternFormatFromName(file.path, format);
+		PatternParser parser(format);
+		parser.feed(bytes.data(), bytes.size());
+		parser.finish(entry.error);
+		file.stats = parser.stats();
+	}
+
+public:
+	// Files that fail to parse are reported and left out of the cache
+	static LibraryScan analyze(const string& directory, PatternCache& cache, int numThreads = 0) {
+		LibraryScan scan;
+		error_code ec;
+		vector<string> paths;
+		for (filesystem::recursive_directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+			PatternFormat format;
+			if (it->is_regular_file(ec) && patternFormatFromName(it->path().string(), format))
+				paths.push_back(it->path().string());
+		}
+		sort(paths.begin(), paths.end());
+
+		scan.entries.resize(paths.size());
+		for (size_t i = 0; i < paths.size(); i++)
+			scan.entries[i].file.path = paths[i];
+
+		runWorkStealing(paths.size(), numThreads, [&](size_t i) { analyzeFile(scan.entries[i], cache); });
+
+		cache.clear();
+		for (const LibraryEntry& entry : scan.entries) {
+			if (!entry.error.empty()) {
+				scan.failed++;
+				continue;
+			}
+			if (entry.fromCache) scan.cached++;
+			else scan.parsed++;
+			cache.put(entry.file);
+		}
+		return scan;
+	}
+
+	// One practice project per design, named after the file
+	static void addToCatalog(const LibraryScan& scan, ProjectCatalog& catalog) {
+		for (const LibraryEntry& entry : scan.entries) {
+			if (!entry.error.empty()) continue;
+			const PatternStats& stats = entry.file.stats;
+			catalog.add(PracticeProject(filesystem::path(entry.file.path).stem().string(), 0,
+				difficultyForStitches(stats.stitches), stats.stitches, 0.0));
+		}
+	}
+
+	static DifficultyLevel difficultyForStitches(int stitches) {
+		if (stitches < EASY_STITCH_LIMIT) return EASY;
+		if (stitches < HARD_STITCH_LIMIT) return INTERMEDIATE;
+		return HARD;
+	}
+};
+
+// Machine Profile- speeds and prices of one machine
+struct MachineProfile {
+	double stitchesPerMinute = 800.0;
+	double trimSeconds = 6.0;         // per trim before a jump
+	double colorChangeSeconds = 20.0; // per thread change
+	double threadCostPerMeter = 0.01;
+	double threadPerLength = 1.3;     // thread used per unit of stitch length, top and bobbin
+	double machineCostPerHour = 12.0;
+	double travelMetersPerMinute = 20.0; // frame speed while jumping
+};
+
+// Machine Estimate- run time and thread for one design
+struct MachineEstimate {
+	int stitches = 0;
+	int trims = 0;
+	int colorChanges = 0;
+	double minutes = 0.0;
+	double travelMeters = 0.0; // moved while jumping
+	vector<double> metersPerColor;
+	double threadMeters = 0.0;
+	double threadCost = 0.0;
+	double machineCost = 0.0;
+
+	int durationMinutes() const { return (int)ceil(minutes); }
+	double totalCost() const { return threadCost + machineCost; }
+};
+
+const double METERS_PER_UNIT = 0.0001; // pattern units are 0.1 mm
+
+// Thread length of records [begin, end), counting only the moves that
+// end in a normal stitch. Jumps are trimmed, so they use no thread.
+// The loop has no branches so the compiler can vectorize it.
+double stitchLength(const StitchPattern& pattern, size_t begin, size_t end) {
+	const int* xs = pattern.xs.data();
+	const int* ys = pattern.ys.data();
+	const StitchType* types = pattern.types.data();
+	double length = 0.0;
+	for (size_t i = max(begin, (size_t)1); i < end; i++) {
+		double dx = (double)(xs[i] - xs[i - 1]);
+		double dy = (double)(ys[i] - ys[i - 1]);
+		double sewn = (double)(types[i] == STITCH_NORMAL);
+		length += sewn * sqrt(dx * dx + dy * dy);
+	}
+	return length;
+}
+
+class MachineEstimator {
+public:
+	static MachineEstimate estimate(const StitchPattern& pattern, const MachineProfile& profile) {
+		MachineEstimate e;
+		size_t n = pattern.size();
+		size_t blockStart = 0;
+		bool inJump = false;
+		for (size_t i = 0; i < n; i++) {
+			StitchType type = pattern.types[i];
+			e.stitches += type == STITCH_NORMAL;
+			if (type == STITCH_JUMP && !inJump) e.trims++; // a run of jumps is one trim
+			if (type == STITCH_JUMP && i > 0)
+				e.travelMeters += hypot(pattern.xs[i] - pattern.xs[i - 1], pattern.ys[i] - pattern.ys[i - 1]) * METERS_PER_UNIT;
+			inJump = type == STITCH_JUMP;
+			if (type == STITCH_COLOR || type == STITCH_END || i + 1 == n) {
+				e.metersPerColor.push_back(stitchLength(pattern, blockStart, i + 1) * profile.threadPerLength * METERS_PER_UNIT);
+				blockStart = i + 1;
+				if (type == STITCH_COLOR) e.colorChanges++;
+				if (type == STITCH_END) break;
+			}
+		}
+
+		for (double meters : e.metersPerColor)
+			e.threadMeters += meters;
+		e.minutes = e.stitches / profile.stitchesPerMinute
+			+ (e.trims * profile.trimSeconds + e.colorChanges * profile.colorChangeSeconds) / 60.0
+			+ e.travelMeters / profile.travelMetersPerMinute;
+		e.threadCost = e.threadMeters * profile.threadCostPerMeter;
+		e.machineCost = e.minutes / 60.0 * profile.machineCostPerHour;
+		return e;
+	}
+
+	static vector<MachineEstimate> estimateAll(const vector<StitchPattern>& patterns, const MachineProfile& profile, int numThreads = 0) {
+		vector<MachineEstimate> estimates(patterns.size());
+		runWorkStealing(patterns.size(), numThreads, [&](size_t i) { estimates[i] = estimate(patterns[i], profile); });
+		return estimates;
+	}
+};
+
+// Duration and cost come from the estimate instead of being typed in
+template <typename Project>
+void applyEstimate(Project& project, const MachineEstimate& e) {
+	project.setDuration(e.durationMinutes());
+	project.setCost(e.totalCost());
+}
+
+// Preview Image- 8-bit RGB, rows top to bottom
+struct PreviewImage {
+	int width = 0;
+	int height = 0;
+	vector<unsigned char> pixels; // width * height * 3
+
+	const unsigned char* at(int x, int y) const { return &pixels[((size_t)y * width + x) * 3]; }
+};
+
+// Binary PPM (P6), readable by most image viewers
+void writePPM(OutputBuffer& out, const PreviewImage& image) {
+	out.append("P6\n").appendInt(image.width).append(' ').appendInt(image.height).append("\n255\n");
+	out.append(string((const char*)image.pixels.data(), image.pixels.size()));
+}
+
+bool savePPM(const PreviewImage& image, const string& filename) {
+	OutputBuffer out;
+	writePPM(out, image);
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (!file) return false;
+	bool ok = out.writeTo(file);
+	return fclose(file) == 0 && ok;
+}
+
+struct PreviewOptions {
+	int size = 512;           // longest side in pixels
+	int margin = 8;
+	float threadWidth = 2.0f; // in pixels
+	int numThreads = 0;
+};
+
+const int PREVIEW_TILE = 64;
+const int NUM_THREAD_COLORS = 8;
+const unsigned char THREAD_COLORS[NUM_THREAD_COLORS][3] = {
+	{ 200, 30, 45 }, { 30, 90, 190 }, { 40, 150, 60 }, { 230, 170, 20 },
+	{ 120, 50, 160 }, { 20, 20, 20 }, { 240, 110, 150 }, { 0, 150, 160 },
+};
+const float PREVIEW_BACKGROUND = 250.0f;
+
+// Pattern Rasterizer- draws every stitch as an anti-aliased line
+// The canvas is cut into tiles and each segment is listed in the tiles its
+// box touches. Tiles are then drawn independently on the work-stealing
+// pool, each into its own small buffer, so no locking is needed.
+class PatternRasterizer {
+private:
+	struct Segment {
+		float ax, ay, bx, by;
+		int color;
+	};
+
+	// Blends one segment into a tile, one row span at a time. The span loop
+	// has no branches so the compiler can vectorize it.
+	static void drawSegment(const Segment& s, float halfWidth, int tileX, int tileY, int tileW, int tileH, float* tile) {
+		int x0 = max(tileX, (int)floor(min(s.ax, s.bx) - halfWidth - 1));
+		int x1 = min(tileX + tileW - 1, (int)ceil(max(s.ax, s.bx) + halfWidth + 1));
+		int y0 = max(tileY, (int)floor(min(s.ay, s.by) - halfWidth - 1));
+		int y1 = min(tileY + tileH - 1, (int)ceil(max(s.ay, s.by) + halfWidth + 1));
+		if (x0 > x1 || y0 > y1) return;
+
+		float dx = s.bx - s.ax, dy = s.by - s.ay;
+		float length2 = dx * dx + dy * dy;
+		float inverse = length2 > 0.0f ? 1.0f / length2 : 0.0f;
+		float r = THREAD_COLORS[s.color][0], g = THREAD_COLORS[s.color][1], b = THREAD_COLORS[s.color][2];
+
+		float reach = halfWidth + 1.0f;
+		float reachLength = reach * sqrt(length2);
+		for (int y = y0; y <= y1; y++) {
+			float py = y + 0.5f - s.ay;
+
+			// Span of this row within reach of the segment: the band around
+			// the line, plus the caps at either end
+			float lo = (float)x0 - s.ax, hi = (float)x1 - s.ax;
+			if (dy != 0.0f) {
+				float a = (py * dx - reachLength) / dy, b = (py * dx + reachLength) / dy;
+				lo = max(lo, min(a, b));
+				hi = min(hi, max(a, b));
+			}
+			if (fabs(py) <= reach) { lo = min(lo, -reach); hi = max(hi, reach); }
+			if (fabs(py - dy) <= reach) { lo = min(lo, dx - reach); hi = max(hi, dx + reach); }
+			int spanStart = max(x0, (int)floor(s.ax + lo - 0.5f));
+			int spanEnd = min(x1, (int)ceil(s.ax + hi));
+
+			float* row = tile + ((size_t)(y - tileY) * tileW) * 3;
+			for (int x = spanStart; x <= spanEnd; x++) {
+				float px = x + 0.5f - s.ax;
+				float t = min(1.0f, max(0.0f, (px * dx + py * dy) * inverse));
+				float ex = px - t * dx, ey = py - t * dy;
+				float alpha = min(1.0f, max(0.0f, halfWidth + 0.5f - sqrt(ex * ex + ey * ey)));
+				float* p = row + (size_t)(x - tileX) * 3;
+				p[0] += (r - p[0]) * alpha;
+				p[1] += (g - p[1]) * alpha;
+				p[2] += (b - p[2]) * alpha;
+			}
+		}
+	}
+
+public:
+	static PreviewImage render(const StitchPattern& pattern, const PreviewOptions& options = PreviewOptions()) {
+		int minX = 0, maxX = 0, minY = 0, maxY = 0;
+		bool first = true;
+		for (size_t i = 0; i < pattern.size(); i++) {
+			if (pattern.types[i] != STITCH_NORMAL) continue;
+			if (first) {
+				minX = maxX = pattern.xs[i];
+				minY = maxY = pattern.ys[i];
+				first = false;
+			}
+			minX = min(minX, pattern.xs[i]);
+			maxX = max(maxX, pattern.xs[i]);
+			minY = min(minY, pattern.ys[i]);
+			maxY = max(maxY, pattern.ys[i]);
+		}
+
+		int designW = max(1, maxX - minX), designH = max(1, maxY - minY);
+		int inner = max(1, options.size - 2 * options.margin);
+		float scale = (float)inner / max(designW, designH);
+
+		PreviewImage image;
+		image.width = (int)ceil(designW * scale) + 2 * options.margin;
+		image.height = (int)ceil(designH * scale) + 2 * options.margin;
+		image.pixels.assign((size_t)image.width * image.height * 3, (unsigned char)PREVIEW_BACKGROUND);
+
+		// Pattern y points up, image rows go down
+		auto toX = [&](int x) { return options.margin + (x - minX) * scale; };
+		auto toY = [&](int y) { return options.margin + (maxY - y) * scale; };
+
+		vector<Segment> segments;
+		int color = 0;
+		for (size_t i = 1; i < pattern.size(); i++) {
+			if (pattern.types[i] == STITCH_COLOR) color = (color + 1) % NUM_THREAD_COLORS;
+			if (pattern.types[i] != STITCH_NORMAL) continue;
+			segments.push_back({ toX(pattern.xs[i - 1]), toY(pattern.ys[i - 1]), toX(pattern.xs[i]), toY(pattern.ys[i]), color });
+		}
+
+		// Segments per tile, in stitch order so later stitches draw on top
+		float halfWidth = options.threadWidth / 2;
+		int tilesX = (image.width + PREVIEW_TILE - 1) / PREVIEW_TILE;
+		int tilesY = (image.height + PREVIEW_TILE - 1) / PREVIEW_TILE;
+		vector<vector<int>> bins((size_t)tilesX * tilesY);
+		for (size_t i = 0; i < segments.size(); i++) {
+			const Segment& s = segments[i];
+			float pad = halfWidth + 1;
+			int tx0 = max(0, (int)((min(s.ax, s.bx) - pad) / PREVIEW_TILE));
+			int tx1 = min(tilesX - 1, (int)((max(s.ax, s.bx) + pad) / PREVIEW_TILE));
+			int ty0 = max(0, (int)((min(s.ay, s.by) - pad) / PREVIEW_TILE));
+			int ty1 = min(tilesY - 1, (int)((max(s.ay, s.by) + pad) / PREVIEW_TILE));
+			for (int ty = ty0; ty <= ty1; ty++)
+				for (int tx = tx0; tx <= tx1; tx++)
+					bins[(size_t)ty * tilesX + tx].push_back((int)i);
+		}
+
+		runWorkStealing(bins.size(), options.numThreads, [&](size_t t) {
+			if (bins[t].empty()) return;
+			int tileX = (int)(t % tilesX) * PREVIEW_TILE;
+			int tileY = (int)(t / tilesX) * PREVIEW_TILE;
+			int tileW = min(PREVIEW_TILE, image.width - tileX);
+			int tileH = min(PREVIEW_TILE, image.height - tileY);
+			vector<float> tile((size_t)tileW * tileH * 3, PREVIEW_BACKGROUND);
+			for (int s : bins[t])
+				drawSegment(segments[s], halfWidth, tileX, tileY, tileW, tileH, tile.data());
+			for (int y = 0; y < tileH; y++) {
+				unsigned char* out = &image.pixels[((size_t)(tileY + y) * image.width + tileX) * 3];
+				const float* in = &tile[(size_t)y * tileW * 3];
+				for (int i = 0; i < tileW * 3; i++)
+					out[i] = (unsigned char)(in[i] + 0.5f);
+			}
+		});
+		return image;
+	}
+};
+
+// Path Options- what the optimizer may change
+struct PathOptions {
+	bool allowReverse = true;   // sew a block from its last stitch to its first
+	bool reorderColors = false; // colors usually layer, so keep their order by default
+	int window = 50;            // how far along the order moves are tried
+	int maxPasses = 4;
+};
+
+// Path Optimization- the reordered design and what it saves
+struct PathOptimization {
+	StitchPattern pattern;
+	double travelBefore = 0.0; // pattern units moved while jumping
+	double travelAfter = 0.0;
+	MachineEstimate before;
+	MachineEstimate after;
+
+	double savedMinutes() const { return before.minutes - after.minutes; }
+};
+
+// Path Optimizer- reorders stitch blocks to cut the jumps between them
+// A block is a run of normal stitches plus the record it is sewn from
+// (the jump landing or wherever the needle was), so every sewn move is
+// kept when blocks are reordered or reversed. Within each color the
+// blocks are chained nearest-neighbor first, using a grid of block ends
+// to find the closest one, then improved with Or-opt (moving runs of 1-3
+// blocks) and, when blocks may be reversed, 2-opt.
+class PathOptimizer {
+private:
+	struct Block {
+		size_t from;       // needle position the first stitch is sewn from
+		size_t begin, end; // stitch records [begin, end)
+	};
+
+	struct Stop {
+		int block;
+		bool reversed;
+	};
+
+	const StitchPattern& pattern;
+	PathOptions options;
+	vector<Block> blocks;
+	vector<vector<int>> colorBlocks; // block ids per color, in sewing order
+	double startX = 0.0, startY = 0.0;
+
+	size_t entryRecord(const Stop& s) const { return s.reversed ? blocks[s.block].end - 1 : blocks[s.block].from; }
+	size_t exitRecord(const Stop& s) const { return s.reversed ? blocks[s.block].from : blocks[s.block].end - 1; }
+
+	double distance(double x, double y, size_t record) const {
+		double dx = pattern.xs[record] - x, dy = pattern.ys[record] - y;
+		return sqrt(dx * dx + dy * dy);
+	}
+
+	double distance(size_t a, size_t b) const {
+		return distance(pattern.xs[a], pattern.ys[a], b);
+	}
+
+	// Cost of moving from tour[a] (or the start when a < 0) to tour[b];
+	// nothing follows the last stop
+	double link(const vector<Stop>& tour, int a, int b, double x, double y) const {
+		if (b >= (int)tour.size()) return 0.0;
+		size_t to = entryRecord(tour[b]);
+		return a < 0 ? distance(x, y, to) : distance(exitRecord(tour[a]), to);
+	}
+
+	vector<Stop> nearestNeighbor(const vector<int>& ids, double x, double y) const {
+		// Grid of block ends, about one block per cell
+		int minX = INT_MAX, maxX = INT_MIN, minY = INT_MAX, maxY = INT_MIN;
+		for (int b : ids) {
+			for (size_t r : { blocks[b].from, blocks[b].end - 1 }) {
+				minX = min(minX, pattern.xs[r]);
+				maxX = max(maxX, pattern.xs[r]);
+				minY = min(minY, pattern.ys[r]);
+				maxY = max(maxY, pattern.ys[r]);
+			}
+		}
+		double area = max(1.0, (double)(maxX - minX) * (maxY - minY));
+		double cell = max(1.0, sqrt(area / ids.size()));
+		int cols = min(1024, (int)((maxX - minX) / cell) + 1);
+		int rows = min(1024, (int)((maxY - minY) / cell) + 1);
+		cell = max(cell, max((maxX - minX) / (double)cols, (maxY - minY) / (double)rows) + 1e-9);
+
+		auto cellX = [&](double px) { return min(cols - 1, max(0, (int)((px - minX) / cell))); };
+		auto cellY = [&](double py) { return min(rows - 1, max(0, (int)((py - minY) / cell))); };
+
+		// Entry 2i sews ids[i] forwards, 2i + 1 backwards
+		vector<vector<int>> grid((size_t)cols * rows);
+		for (size_t i = 0; i < ids.size(); i++) {
+			const Block& b = blocks[ids[i]];
+			grid[(size_t)cellY(pattern.ys[b.from]) * cols + cellX(pattern.xs[b.from])].push_back((int)(2 * i));
+			if (options.allowReverse)
+				grid[(size_t)cellY(pattern.ys[b.end - 1]) * cols + cellX(pattern.xs[b.end - 1])].push_back((int)(2 * i + 1));
+		}
+
+		vector<bool> used(ids.size(), false);
+		vector<Stop> tour;
+		while (tour.size() < ids.size()) {
+			int cx = cellX(x), cy = cellY(y);
+			int best = -1;
+			double bestDistance = 0.0;
+			// Anything beyond ring r is at least r cells away
+			for (int r = 0; r <= max(cols, rows); r++) {
+				for (int gy = max(0, cy - r); gy <= min(rows - 1, cy + r); gy++) {
+					// Whole row on the top and bottom edge of the ring, else its two sides
+					int step = (abs(gy - cy) == r) ? 1 : max(1, 2 * r);
+					for (int gx = cx - r; gx <= cx + r; gx += step) {
+						if (gx < 0 || gx >= cols) continue;
+						vector<int>& entries = grid[(size_t)gy * cols + gx];
+						for (size_t k = 0; k < entries.size();) {
+							int e = entries[k];
+							if (used[e / 2]) { // drop entries of blocks already placed
+								entries[k] = entries.back();
+								entries.pop_back();
+								continue;
+							}
+							const Block& b = blocks[ids[e / 2]];
+							double d = distance(x, y, (e & 1) ? b.end - 1 : b.from);
+							if (best < 0 || d < bestDistance || (d == bestDistance && e < best)) {
+								best = e;
+								bestDistance = d;
+							}
+							k++;
+						}
+					}
+				}
+				if (best >= 0 && bestDistance <= r * cell) break;
+			}
+			used[best / 2] = true;
+			Stop stop = { ids[best / 2], (best & 1) != 0 };
+			tour.push_back(stop);
+			x = pattern.xs[exitRecord(stop)];
+			y = pattern.ys[exitRecord(stop)];
+		}
+		return tour;
+	}
+
+	// Moves a run of 1-3 stops to a better place nearby
+	bool orOpt(vector<Stop>& tour, double x, double y) const {
+		const double EPSILON = 1e-9;
+		int m = (int)tour.size();
+		bool improved = false;
+		for (int length = 1; length <= 3; length++) {
+			for (int i = 0; i + length <= m; i++) {
+				int last = i + length - 1;
+				double removed = link(tour, i - 1, i, x, y) + link(tour, last, last + 1, x, y)
+					- (last + 1 < m ? link(tour, i - 1, last + 1, x, y) : 0.0);
+				for (int j = max(-1, i - options.window); j <= min(m - 1, last + options.window); j++) {
+					if (j >= i - 1 && j <= last) continue;
+					double added = link(tour, j, i, x, y) + (j + 1 < m ? link(tour, last, j + 1, x, y) : 0.0)
+						- link(tour, j, j + 1, x, y);
+					if (added < removed - EPSILON) {
+						if (j < i) rotate(tour.begin() + j + 1, tour.begin() + i, tour.begin() + last + 1);
+						else rotate(tour.begin() + i, tour.begin() + last + 1, tour.begin() + j + 1);
+						improved = true;
+						break;
+					}
+				}
+			}
+		}
+		return improved;
+	}
+
+	// Reverses a stretch of stops, sewing each of them backwards
+	bool twoOpt(vector<Stop>& tour, double x, double y) const {
+		const double EPSILON = 1e-9;
+		int m = (int)tour.size();
+		bool improved = false;
+		for (int i = 0; i < m; i++) {
+			for (int j = i + 1; j < m && j <= i + options.window; j++) {
+				double before = link(tour, i - 1, i, x, y) + link(tour, j, j + 1, x, y);
+				size_t newEntry = exitRecord(tour[j]);
+				double after = (i == 0 ? distance(x, y, newEntry) : distance(exitRecord(tour[i - 1]), newEntry))
+					+ (j + 1 < m ? distance(entryRecord(tour[i]), entryRecord(tour[j + 1])) : 0.0);
+				if (after < before - EPSILON) {
+					reverse(tour.begin() + i, tour.begin() + j + 1);
+					for (int k = i; k <= j; k++)
+						tour[k].reversed = !tour[k].reversed;
+					improved = true;
+				}
+			}
+		}
+		return improved;
+	}
+
+	vector<Stop> optimizeColor(const vector<int>& ids, double x, double y) const {
+		if (ids.empty()) return {};
+		vector<Stop> tour = nearestNeighbor(ids, x, y);
+		for (int pass = 0; pass < options.maxPasses; pass++) {
+			bool improved = orOpt(tour, x, y);
+			if (options.allowReverse) improved = twoOpt(tour, x, y) || improved;
+			if (!improved) break;
+		}
+		return tour;
+	}
+
+	// Sews the stops in order: a jump to each block that does not start
+	// where the needle is, a color change between colors (one per color
+	// record in the input, even around colors with no blocks), then the end.
+	// A reversed block sews its stitches backwards and finishes on the
+	// record it was originally sewn from, so it keeps every segment.
+	StitchPattern build(const vector<vector<Stop>>& colors) const {
+		StitchPattern out;
+		int x = (int)startX, y = (int)startY;
+		for (size_t c = 0; c < colors.size(); c++) {
+			if (c > 0) out.add(x, y, STITCH_COLOR);
+			for (const Stop& s : colors[c]) {
+				size_t entry = entryRecord(s);
+				if (pattern.xs[entry] != x || pattern.ys[entry] != y)
+					out.add(pattern.xs[entry], pattern.ys[entry], STITCH_JUMP);
+				const Block& b = blocks[s.block];
+				if (!s.reversed) {
+					for (size_t r = b.begin; r < b.end; r++)
+						out.add(pattern.xs[r], pattern.ys[r], STITCH_NORMAL);
+				}
+				else {
+					for (size_t r = b.end - 1; r > b.begin; r--)
+						out.add(pattern.xs[r - 1], pattern.ys[r - 1], STITCH_NORMAL);
+					out.add(pattern.xs[b.from], pattern.ys[b.from], STITCH_NORMAL);
+				}
+				x = pattern.xs[exitRecord(s)];
+				y = pattern.ys[exitRecord(s)];
+			}
+		}
+		out.add(x, y, STITCH_END);
+		return out;
+	}
+
+	// Distance moved by jump records, as MachineEstimator measures it
+	static double jumpTravel(const StitchPattern& p) {
+		double travel = 0.0;
+		for (size_t i = 1; i < p.size(); i++) {
+			if (p.types[i] != STITCH_JUMP) continue;
+			double dx = p.xs[i] - p.xs[i - 1], dy = p.ys[i] - p.ys[i - 1];
+			travel += sqrt(dx * dx + dy * dy);
+		}
+		return travel;
+	}
+
+	PathOptimizer(const StitchPattern& p, const PathOptions& o) : pattern(p), options(o) {
+		if (pattern.size() > 0) {
+			startX = pattern.xs[0];
+			startY = pattern.ys[0];
+		}
+		colorBlocks.emplace_back();
+		for (size_t i = 0; i < pattern.size();) {
+			StitchType type = pattern.types[i];
+			if (type == STITCH_END) break;
+			if (type == STITCH_COLOR) colorBlocks.emplace_back(); // even with nothing sewn in it
+			if (type != STITCH_NORMAL) {
+				i++;
+				continue;
+			}
+			size_t end = i;
+			while (end < pattern.size() && pattern.types[end] == STITCH_NORMAL) end++;
+			colorBlocks.back().push_back((int)blocks.size());
+			blocks.push_back({ i > 0 ? i - 1 : i, i, end });
+			i = end;
+		}
+	}
+
+	PathOptimization run(const MachineProfile& profile) const {
+		PathOptimization result;
+		result.travelBefore = jumpTravel(pattern);
+		result.before = MachineEstimator::estimate(pattern, profile);
+
+		vector<bool> done(colorBlocks.size(), false);
+		vector<vector<Stop>> optimized;
+		double x = startX, y = startY;
+		for (size_t n = 0; n < colorBlocks.size(); n++) {
+			size_t next = n;
+			if (options.reorderColors) {
+				// The remaining color whose nearest block start is closest;
+				// colors with no blocks are left for last
+				double best = -1.0;
+				next = 0;
+				while (done[next]) next++;
+				for (size_t c = 0; c < colorBlocks.size(); c++) {
+					if (done[c]) continue;
+					for (int b : colorBlocks[c]) {
+						double d = distance(x, y, blocks[b].from);
+						if (best < 0 || d < best) {
+							best = d;
+							next = c;
+						}
+					}
+				}
+			}
+			done[next] = true;
+			optimized.push_back(optimizeColor(colorBlocks[next], x, y));
+			if (!optimized.back().empty()) {
+				x = pattern.xs[exitRecord(optimized.back().back())];
+				y = pattern.ys[exitRecord(optimized.back().back())];
+			}
+		}
+		result.pattern = build(optimized);
+		result.travelAfter = jumpTravel(result.pattern);
+		result.after = MachineEstimator::estimate(result.pattern, profile);
+
+		// The heuristics can lose to the input's own order; never hand back worse
+		if (result.travelAfter >= result.travelBefore || result.after.minutes > result.before.minutes) {
+			result.pattern = pattern;
+			result.travelAfter = result.travelBefore;
+			result.after = result.before;
+		}
+		return result;
+	}
+
+public:
+	static PathOptimization optimize(const StitchPattern& pattern, const MachineProfile& profile, const PathOptions& options = PathOptions()) {
+		return PathOptimizer(pattern, options).run(profile);
+	}
+};
+
+// Takes the machine time the optimizer saved off the item's duration
+void applyOptimization(EmbroideryItem& item, const PathOptimization& result) {
+	int saved = (int)floor(result.savedMinutes());
+	if (saved > 0) item.setDuration(max(0, item.getDuration() - saved));
+}
+
+// Invoice- everything billed to one client
+struct Invoice {
+	int clientId = 0;
+	string clientName;
+	int projects = 0;
+	double cost = 0.0;
+	long long duration = 0;
+};
+
+// Billing Engine- per-client totals for every commission in the catalog
+// Each worker sums a slice of the commissions into its own array indexed
+// by client id, then the arrays are added together.
+class BillingEngine {
+public:
+	static vector<Invoice> billAll(const ProjectCatalog& catalog, int numThreads = 0) {
+		const vector<CommissionProject>& projects = catalog.getCommissionProjects();
+		const vector<int>& clientIds = catalog.getCommissionClientIds();
+		int numClients = catalog.getClients().size();
+		size_t n = projects.size();
+
+		if (numThreads <= 0)
+			numThreads = max(1, (int)thread::hardware_concurrency());
+		numThreads = (int)min((size_t)numThreads, max((size_t)1, n / 4096 + 1));
+
+		// One slice per task, each summed into its own array
+		vector<vector<Invoice>> partials(numThreads, vector<Invoice>(numClients));
+		runWorkStealing(numThreads, numThreads, [&](size_t t) {
+			size_t begin = n * t / numThreads;
+			size_t end = n * (t + 1) / numThreads;
+			vector<Invoice>& local = partials[t];
+			for (size_t i = begin; i < end; i++) {
+				Invoice& inv = local[clientIds[i]];
+				inv.projects++;
+				inv.cost += projects[i].getCostInfo().getCost();
+				inv.duration += projects[i].getDuration();
+			}
+		});
+
+		vector<Invoice> invoices(numClients);
+		for (int c = 0; c < numClients; c++) {
+			invoices[c].clientId = c;
+			invoices[c].clientName = catalog.getClients().getName(c);
+			for (int t = 0; t < numThreads; t++) {
+				invoices[c].projects += partials[t][c].projects;
+				invoices[c].cost += partials[t][c].cost;
+				invoices[c].duration += partials[t][c].duration;
+			}
+		}
+		return invoices;
+	}
+
+	static void writeInvoices(ostream& out, const vector<Invoice>& invoices) {
+		out << left << setw(20) << "Client"
+			<< setw(10) << "Projects"
+			<< setw(10) << "Duration"
+			<< setw(12) << "Amount" << "\n";
+		for (const Invoice& inv : invoices) {
+			out << left << setw(20) << inv.clientName
+				<< setw(10) << inv.projects
+				<< setw(10) << inv.duration
+				<< setw(12) << CostInfo(inv.cost).formattedCost() << "\n";
+		}
+	}
+};
+
+// Totals for a group of sessions
+struct SessionTotals {
+	double hours = 0.0;
+	double cost = 0.0;
+	int count = 0;
+};
+
+// Time Index- sessions ordered by timestamp
+// In-order inserts are appended to a sorted run with prefix sums so a range
+// total is two binary searches. Out-of-order inserts go to a small ordered
+// buffer that is merged into the run once it gets too big.
+class SessionTimeIndex {
+private:
+	static const size_t MAX_PENDING = 256;
+
+	vector<long long> runTimes;
+	vector<double> runHours; // prefix sums, runHours[i] = hours of the first i entries
+	vector<double> runCosts; // prefix sums, same layout as runHours
+	multimap<long long, pair<double, double>> pending;
+
+	void appendToRun(long long t, double hours, double cost) {
+		if (runHours.empty()) {
+			runHours.push_back(0.0);
+			runCosts.push_back(0.0);
+		}
+		runTimes.push_back(t);
+		runHours.push_back(runHours.back() + hours);
+		runCosts.push_back(runCosts.back() + cost);
+	}
+
+	void mergePending() {
+		vector<long long> oldTimes;
+		vector<double> oldHours, oldCosts;
+		oldTimes.swap(runTimes);
+		oldHours.swap(runHours);
+		oldCosts.swap(runCosts);
+
+		size_t i = 0;
+		auto it = pending.begin();
+		while (i < oldTimes.size() || it != pending.end()) {
+			if (it == pending.end() || (i < oldTimes.size() && oldTimes[i] <= it->first)) {
+				appendToRun(oldTimes[i], oldHours[i + 1] - oldHours[i], oldCosts[i + 1] - oldCosts[i]);
+				i++;
+			}
+			else {
+				appendToRun(it->first, it->second.first, it->second.second);
+				++it;
+			}
+		}
+		pending.clear();
+	}
+
+public:
+	void insert(long long t, double hours, double cost) {
+		if (pending.empty() && (runTimes.empty() || t >= runTimes.back())) {
+			appendToRun(t, hours, cost);
+			return;
+		}
+		pending.insert({ t, { hours, cost } });
+		if (pending.size() > MAX_PENDING)
+			mergePending();
+	}
+
+	int size() const {
+		return (int)(runTimes.size() + pending.size());
+	}
+
+	// Totals for sessions with from <= timestamp < to
+	SessionTotals totalsBetween(long long from, long long to) const {
+		SessionTotals totals;
+		if (to <= from) return totals;
+
+		size_t lo = lower_bound(runTimes.begin(), runTimes.end(), from) - runTimes.begin();
+		size_t hi = lower_bound(runTimes.begin(), runTimes.end(), to) - runTimes.begin();
+		if (hi > lo) {
+			totals.hours = runHours[hi] - runHours[lo];
+			totals.cost = runCosts[hi] - runCosts[lo];
+			totals.count = (int)(hi - lo);
+		}
+
+		for (auto it = pending.lower_bound(from); it != pending.end() && it->first < to; ++it) {
+			totals.hours += it->second.first;
+			totals.cost += it->second.second;
+			totals.count++;
+		}
+		return totals;
+	}
+};
+
+// Calendar helpers (UTC)
+long long floorDiv(long long a, long long b) {
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+long long dayKey(long long t) {
+	return floorDiv(t, SECONDS_PER_DAY);
+}
+
+// Weeks start on Monday; 1970-01-01 was a Thursday
+long long weekKey(long long t) {
+	return floorDiv(dayKey(t) + 3, 7);
+}
+
+// year * 12 + (month - 1), using the days-to-civil conversion
+long long monthKey(long long t) {
+	long long z = dayKey(t) + 719468;
+	long long era = floorDiv(z, 146097);
+	long long doe = z - era * 146097;
+	long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	long long mp = (5 * doy + 2) / 153;
+	long long month = (mp < 10) ? mp + 3 : mp - 9;
+	long long year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+	return year * 12 + (month - 1);
+}
+
+// Rollup Bucket
+struct RollupBucket {
+	double hours = 0.0;
+	double cost = 0.0;
+	int count = 0;
+	int difficultyCounts[HARD_VALUE + 1] = {}; // indexed by DifficultyLevel
+};
+
+// Rollups- per day/week/month totals kept up to date on every insert
+class SessionRollups {
+private:
+	map<long long, RollupBucket> days;
+	map<long long, RollupBucket> weeks;
+	map<long long, RollupBucket> months;
+
+	static void addTo(RollupBucket& b, const Session& s) {
+		b.hours += s.hours;
+		b.cost += s.cost;
+		b.count++;
+		if (s.difficulty >= EASY && s.difficulty <= HARD)
+			b.difficultyCounts[s.difficulty]++;
+	}
+
+	static RollupBucket find(const map<long long, RollupBucket>& m, long long key) {
+		auto it = m.find(key);
+		return (it == m.end()) ? RollupBucket() : it->second;
+	}
+
+	static vector<pair<long long, RollupBucket>> range(const map<long long, RollupBucket>& m,
+		long long firstKey, long long lastKey) {
+		vector<pair<long long, RollupBucket>> result;
+		for (auto it = m.lower_bound(firstKey); it != m.end() && it->first <= lastKey; ++it)
+			result.push_back(*it);
+		return result;
+	}
+
+public:
+	void add(const Session& s) {
+		addTo(days[dayKey(s.timestamp)], s);
+		addTo(weeks[weekKey(s.timestamp)], s);
+		addTo(months[monthKey(s.timestamp)], s);
+	}
+
+	RollupBucket getDay(long long t) const { return find(days, dayKey(t)); }
+	RollupBucket getWeek(long long t) const { return find(weeks, weekKey(t)); }
+	RollupBucket getMonth(long long t) const { return find(months, monthKey(t)); }
+
+	// Non-empty buckets between two timestamps (inclusive), keyed by period
+	vector<pair<long long, RollupBucket>> weeklyTrend(long long from, long long to) const {
+		return range(weeks, weekKey(from), weekKey(to));
+	}
+
+	vector<pair<long long, RollupBucket>> monthlyTrend(long long from, long long to) const {
+		return range(months, monthKey(from), monthKey(to));
+	}
+};
+
+// Bit counting without compiler intrinsics
+int popcount64(unsigned long long x) {
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+// Compressed Bitmap- roaring-style row sets
+// Rows are split by their high 16 bits. Each chunk keeps a sorted array of
+// low bits while sparse and switches to a 65536-bit bitset once dense.
+class RoaringBitmap {
+private:
+	static const int ARRAY_LIMIT = 4096;
+	static const int BITSET_WORDS = 1024;
+
+	struct Container {
+		unsigned int key = 0;                 // high 16 bits
+		int cardinality = 0;
+		vector<unsigned short> values;        // sorted, used while sparse
+		vector<unsigned long long> bits;      // used once dense
+
+		bool isBitset() const { return !bits.empty(); }
+
+		bool contains(unsigned short low) const {
+			if (isBitset())
+				return (bits[low >> 6] >> (low & 63)) & 1ULL;
+			return binary_search(values.begin(), values.end(), low);
+		}
+
+		void toBitset() {
+			bits.assign(BITSET_WORDS, 0ULL);
+			for (unsigned short v : values)
+				bits[v >> 6] |= 1ULL << (v & 63);
+			values.clear();
+			values.shrink_to_fit();
+		}
+
+		void toArray() {
+			values.clear();
+			for (int w = 0; w < BITSET_WORDS; w++) {
+				unsigned long long word = bits[w];
+				while (word) {
+					int bit = popcount64((word & (~word + 1)) - 1); // index of lowest set bit
+					values.push_back((unsigned short)(w * 64 + bit));
+					word &= word - 1;
+				}
+			}
+			bits.clear();
+			bits.shrink_to_fit();
+		}
+
+		void add(unsigned short low) {
+			if (isBitset()) {
+				unsigned long long mask = 1ULL << (low & 63);
+				if (!(bits[low >> 6] & mask)) {
+					bits[low >> 6] |= mask;
+					cardinality++;
+				}
+				return;
+			}
+			auto it = lower_bound(values.begin(), values.end(), low);
+			if (it != values.end() && *it == low) return;
+			values.insert(it, low);
+			cardinality++;
+			if (cardinality > ARRAY_LIMIT)
+				toBitset();
+		}
+
+		// Fix up representation after a bitwise operation
+		void normalize() {
+			if (isBitset()) {
+				cardinality = 0;
+				for (unsigned long long w : bits)
+					cardinality += popcount64(w);
+				if (cardinality <= ARRAY_LIMIT)
+					toArray();
+			}
+			else {
+				cardinality = (int)values.size();
+				if (cardinality > ARRAY_LIMIT)
+					toBitset();
+			}
+		}
+	};
+
+	vector<Container> containers; // sorted by key
+
+	static Container intersect(const Container& a, const Container& b) {
+		Container out;
+		out.key = a.key;
+		if (a.isBitset() && b.isBitset()) {
+			out.bits.resize(BITSET_WORDS);
+			for (int w = 0; w < BITSET_WORDS; w++)
+				out.bits[w] = a.bits[w] & b.bits[w];
+		}
+		else if (a.isBitset() || b.isBitset()) {
+			const Container& arr = a.isBitset() ? b : a;
+			const Container& set = a.isBitset() ? a : b;
+			for (unsigned short v : arr.values)
+				if (set.contains(v)) out.values.push_back(v);
+		}
+		else {
+			set_intersection(a.values.begin(), a.values.end(),
+				b.values.begin(), b.values.end(), back_inserter(out.values));
+		}
+		out.normalize();
+		return out;
+	}
+
+	static Container unite(const Container& a, const Container& b) {
+		Container out;
+		out.key = a.key;
+		if (a.isBitset() || b.isBitset()) {
+			out.bits.assign(BITSET_WORDS, 0ULL);
+			for (const Container* c : { &a, &b }) {
+				if (c->isBitset()) {
+					for (int w = 0; w < BITSET_WORDS; w++) out.bits[w] |= c->bits[w];
+				}
+				else {
+					for (unsigned short v : c->values) out.bits[v >> 6] |= 1ULL << (v & 63);
+				}
+			}
+		}
+		else {
+			set_union(a.values.begin(), a.values.end(),
+				b.values.begin(), b.values.end(), back_inserter(out.values));
+		}
+		out.normalize();
+		return out;
+	}
+
+	static int intersectCount(const Container& a, const Container& b) {
+		int count = 0;
+		if (a.isBitset() && b.isBitset()) {
+			for (int w = 0; w < BITSET_WORDS; w++)
+				count += popcount64(a.bits[w] & b.bits[w]);
+		}
+		else {
+			const Container& small = a.isBitset() ? b : a;
+			const Container& other = a.isBitset() ? a : b;
+			for (unsigned short v : small.values)
+				if (other.contains(v)) count++;
+		}
+		return count;
+	}
+
+public:
+	void add(unsigned int row) {
+		unsigned int key = row >> 16;
+		auto it = lower_bound(containers.begin(), containers.end(), key,
+			[](const Container& c, unsigned int k) { return c.key < k; });
+		if (it == containers.end() || it->key != key) {
+			Container c;
+			c.key = key;
+			it = containers.insert(it, c);
+		}
+		it->add((unsigned short)(row & 0xFFFF));
+	}
+
+	bool contains(unsigned int row) const {
+		unsigned int key = row >> 16;
+		auto it = lower_bound(containers.begin(), containers.end(), key,
+			[](const Container& c, unsigned int k) { return c.key < k; });
+		return it != containers.end() && it->key == key && it->contains((unsigned short)(row & 0xFFFF));
+	}
+
+	int cardinality() const {
+		int total = 0;
+		for (const Container& c : containers)
+			total += c.cardinality;
+		return total;
+	}
+
+	bool isEmpty() const {
+		return containers.empty();
+	}
+
+	RoaringBitmap operator&(const RoaringBitmap& other) const {
+		RoaringBitmap out;
+		size_t i = 0, j = 0;
+		while (i < containers.size() && j < other.containers.size()) {
+			if (containers[i].key < other.containers[j].key) i++;
+			else if (containers[i].key > other.containers[j].key) j++;
+			else {
+				Container c = intersect(containers[i++], other.containers[j++]);
+				if (c.cardinality > 0) out.containers.push_back(c);
+			}
+		}
+		return out;
+	}
+
+	RoaringBitmap operator|(const RoaringBitmap& other) const {
+		RoaringBitmap out;
+		size_t i = 0, j = 0;
+		while (i < containers.size() || j < other.containers.size()) {
+			if (j == other.containers.size() || (i < containers.size() && containers[i].key < other.containers[j].key))
+				out.containers.push_back(containers[i++]);
+			else if (i == containers.size() || containers[i].key > other.containers[j].key)
+				out.containers.push_back(other.containers[j++]);
+			else
+				out.containers.push_back(unite(containers[i++], other.containers[j++]));
+		}
+		return out;
+	}
+
+	// Size of the intersection without building it
+	int andCardinality(const RoaringBitmap& other) const {
+		int count = 0;
+		size_t i = 0, j = 0;
+		while (i < containers.size() && j < other.containers.size()) {
+			if (containers[i].key < other.containers[j].key) i++;
+			else if (containers[i].key > other.containers[j].key) j++;
+			else count += intersectCount(containers[i++], other.containers[j++]);
+		}
+		return count;
+	}
+
+	template <typename Func>
+	void forEach(Func f) const {
+		for (const Container& c : containers) {
+			unsigned int high = c.key << 16;
+			if (c.isBitset()) {
+				for (int w = 0; w < BITSET_WORDS; w++) {
+					unsigned long long word = c.bits[w];
+					while (word) {
+						int bit = popcount64((word & (~word + 1)) - 1); // index of lowest set bit
+						f(high | (unsigned int)(w * 64 + bit));
+						word &= word - 1;
+					}
+				}
+			}
+			else {
+				for (unsigned short v : c.values)
+					f(high | v);
+			}
+		}
+	}
+};
+
+// Difficulty Index- one bitmap per DifficultyLevel plus budget flags
+class DifficultyBitmapIndex {
+private:
+	RoaringBitmap byDifficulty[HARD_VALUE + 1];
+	RoaringBitmap overBudget;    // cost > maxCostGood
+	RoaringBitmap shortSessions; // hours < minHoursGood
+	double minHoursGood;
+	double maxCostGood;
+
+public:
+	DifficultyBitmapIndex(double minHours = MIN_HOURS_GOOD, double maxCost = MAX_COST_GOOD)
+		: minHoursGood(minHours), maxCostGood(maxCost) {}
+
+	void add(unsigned int row, const Session& s) {
+		if (s.difficulty >= EASY && s.difficulty <= HARD)
+			byDifficulty[s.difficulty].add(row);
+		if (s.cost > maxCostGood)
+			overBudget.add(row);
+		if (s.hours < minHoursGood)
+			shortSessions.add(row);
+	}
+
+	const RoaringBitmap& rowsWith(DifficultyLevel d) const {
+		static const RoaringBitmap empty;
+		return (d >= EASY && d <= HARD) ? byDifficulty[d] : empty;
+	}
+
+	const RoaringBitmap& overBudgetRows() const { return overBudget; }
+	const RoaringBitmap& shortSessionRows() const { return shortSessions; }
+};
+
+// Posting List- increasing row ids stored as varint-encoded gaps
+class PostingList {
+private:
+	vector<unsigned char> bytes;
+	unsigned int lastRow = 0;
+	int count = 0;
+
+public:
+	// Rows must be added in increasing order; repeats are ignored
+	void add(unsigned int row) {
+		if (count > 0 && row <= lastRow) return;
+		unsigned int gap = (count == 0) ? row : row - lastRow;
+		while (gap >= 0x80) {
+			bytes.push_back((unsigned char)(gap | 0x80));
+			gap >>= 7;
+		}
+		bytes.push_back((unsigned char)gap);
+		lastRow = row;
+		count++;
+	}
+
+	int size() const { return count; }
+	size_t byteSize() const { return bytes.size(); }
+
+	unsigned int maxRow() const { return lastRow; }
+
+	vector<unsigned int> decode() const {
+		vector<unsigned int> rows;
+		rows.reserve(count);
+		forEachRow([&](unsigned int row) { rows.push_back(row); });
+		return rows;
+	}
+
+	template <typename Func>
+	void forEachRow(Func f) const {
+		unsigned int row = 0;
+		size_t i = 0;
+		for (int n = 0; n < count; n++) {
+			unsigned int gap = 0;
+			int shift = 0;
+			while (bytes[i] & 0x80) {
+				gap |= (unsigned int)(bytes[i++] & 0x7F) << shift;
+				shift += 7;
+			}
+			gap |= (unsigned int)bytes[i++] << shift;
+			row = (n == 0) ? gap : row + gap;
+			f(row);
+		}
+	}
+};
+
+// Lowercase words made of letters and digits
+vector<string> tokenize(const string& text) {
+	vector<string> tokens;
+	string current;
+	for (char ch : text) {
+		unsigned char c = (unsigned char)ch;
+		if (isalnum(c)) {
+			current += (char)tolower(c);
+		}
+		else if (!current.empty()) {
+			tokens.push_back(current);
+			current.clear();
+		}
+	}
+	if (!current.empty())
+		tokens.push_back(current);
+	return tokens;
+}
+
+// Description Index- inverted index from words to session rows
+class DescriptionIndex {
+private:
+	map<string, PostingList> terms; // ordered so prefixes are a contiguous range
+
+	static vector<unsigned int> intersectRows(const vector<unsigned int>& a, const vector<unsigned int>& b) {
+		vector<unsigned int> out;
+		set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(out));
+		return out;
+	}
+
+	// Every list is decoded once into a shared bitset, which is then read
+	// back in row order, so the cost is linear in the rows matched
+	static vector<unsigned int> uniteLists(const vector<const PostingList*>& lists) {
+		if (lists.empty()) return vector<unsigned int>();
+		if (lists.size() == 1) return lists[0]->decode();
+
+		unsigned int maxRow = 0;
+		size_t total = 0;
+		for (const PostingList* list : lists) {
+			maxRow = max(maxRow, list->maxRow());
+			total += list->size();
+		}
+		vector<unsigned long long> bits(maxRow / 64 + 1, 0);
+		for (const PostingList* list : lists)
+			list->forEachRow([&](unsigned int row) { bits[row >> 6] |= 1ULL << (row & 63); });
+
+		vector<unsigned int> rows;
+		rows.reserve(total);
+		for (size_t w = 0; w < bits.size(); w++) {
+			for (unsigned long long word = bits[w]; word != 0; word &= word - 1) {
+				unsigned long long lowest = word & (~word + 1);
+				rows.push_back((unsigned int)(w * 64 + popcount64(lowest - 1)));
+			}
+		}
+		return rows;
+	}
+
+	static string normalize(const string& term) {
+		vector<string> tokens = tokenize(term);
+		return tokens.empty() ? "" : tokens[0];
+	}
+
+public:
+	// Rows must be added in increasing order
+	void add(unsigned int row, const string& description) {
+		for (const string& token : tokenize(description))
+			terms[token].add(row);
+	}
+
+	int termCount() const {
+		return (int)terms.size();
+	}
+
+	vector<unsigned int> matchTerm(const string& term) const {
+		auto it = terms.find(normalize(term));
+		return (it == terms.end()) ? vector<unsigned int>() : it->second.decode();
+	}
+
+	vector<unsigned int> matchPrefix(const string& prefix) const {
+		string p = normalize(prefix);
+		vector<const PostingList*> lists;
+		if (p.empty()) return vector<unsigned int>();
+		for (auto it = terms.lower_bound(p); it != terms.end() && it->first.compare(0, p.size(), p) == 0; ++it)
+			lists.push_back(&it->second);
+		return uniteLists(lists);
+	}
+
+	// Rows containing every term, starting from the rarest one
+	vector<unsigned int> matchAll(const vector<string>& words) const {
+		vector<const PostingList*> lists;
+		for (const string& w : words) {
+			auto it = terms.find(normalize(w));
+			if (it == terms.end()) return vector<unsigned int>();
+			lists.push_back(&it->second);
+		}
+		if (lists.empty()) return vector<unsigned int>();
+		sort(lists.begin(), lists.end(),
+			[](const PostingList* a, const PostingList* b) { return a->size() < b->size(); });
+
+		vector<unsigned int> rows = lists[0]->decode();
+		for (size_t i = 1; i < lists.size() && !rows.empty(); i++)
+			rows = intersectRows(rows, lists[i]->decode());
+		return rows;
+	}
+
+	// Rows containing at least one of the terms
+	vector<unsigned int> matchAny(const vector<string>& words) const {
+		vector<const PostingList*> lists;
+		for (const string& w : words) {
+			auto it = terms.find(normalize(w));
+			if (it != terms.end()) lists.push_back(&it->second);
+		}
+		return uniteLists(lists);
+	}
+};
+
+// Zone Map- min/max summary of one segment
+struct ZoneMap {
+	double minHours = numeric_limits<double>::infinity();
+	double maxHours = -numeric_limits<double>::infinity();
+	double minCost = numeric_limits<double>::infinity();
+	double maxCost = -numeric_limits<double>::infinity();
+	int difficultyMask = 0; // bit (1 << difficulty) set when present
+	long long minTime = numeric_limits<long long>::max();
+	long long maxTime = numeric_limits<long long>::min();
+};
+
+// Segment- up to SEGMENT_SIZE sessions stored column by column
+struct SessionSegment {
+	vector<string> descriptions;
+	vector<double> hours;
+	vector<double> costs;
+	vector<DifficultyLevel> difficulties;
+	vector<long long> timestamps;
+	vector<int> projectIds;
+	ZoneMap zone;
+
+	int size() const { return (int)hours.size(); }
+};
+
+// Filter- inclusive bounds on each column
+struct SessionFilter {
+	double minHours = -numeric_limits<double>::infinity();
+	double maxHours = numeric_limits<double>::infinity();
+	double minCost = -numeric_limits<double>::infinity();
+	double maxCost = numeric_limits<double>::infinity();
+	int difficultyMask = (1 << EASY) | (1 << INTERMEDIATE) | (1 << HARD);
+	long long fromTime = numeric_limits<long long>::min();
+	long long toTime = numeric_limits<long long>::max();
+
+	// Strict bounds are the inclusive bound on the next representable value
+	static SessionFilter costAbove(double c) {
+		SessionFilter f;
+		f.minCost = nextafter(c, numeric_limits<double>::infinity());
+		return f;
+	}
+
+	static SessionFilter hoursBelow(double h) {
+		SessionFilter f;
+		f.maxHours = nextafter(h, -numeric_limits<double>::infinity());
+		return f;
+	}
+
+	// False when no row in the segment can pass
+	bool mayMatch(const ZoneMap& z) const {
+		return z.maxHours >= minHours && z.minHours <= maxHours
+			&& z.maxCost >= minCost && z.minCost <= maxCost
+			&& (z.difficultyMask & difficultyMask) != 0
+			&& z.maxTime >= fromTime && z.minTime <= toTime;
+	}
+
+	// True when every row in the segment passes
+	bool coversAll(const ZoneMap& z) const {
+		return z.minHours >= minHours && z.maxHours <= maxHours
+			&& z.minCost >= minCost && z.maxCost <= maxCost
+			&& (z.difficultyMask & ~difficultyMask) == 0
+			&& z.minTime >= fromTime && z.maxTime <= toTime;
+	}
+
+	bool matches(const SessionSegment& seg, int i) const {
+		return seg.hours[i] >= minHours && seg.hours[i] <= maxHours
+			&& seg.costs[i] >= minCost && seg.costs[i] <= maxCost
+			&& ((1 << seg.difficulties[i]) & difficultyMask) != 0
+			&& seg.timestamps[i] >= fromTime && seg.timestamps[i] <= toTime;
+	}
+};
+
+// Scan Stats- how many segments the zone maps let us skip
+struct ScanStats {
+	long long segmentsScanned = 0;
+	long long segmentsSkipped = 0;
+	long long segmentsFullMatch = 0; // taken whole without checking rows
+	long long rowsScanned = 0;
+};
+
+// Session Store- fixed-size columnar segments with zone maps
+class SessionStore {
+private:
+	vector<SessionSegment> segments;
+	int numRows = 0;
+	mutable ScanStats stats;
+
+	// Calls f(segmentIndex, row) for each passing row
+	template <typename Func>
+	void scan(const SessionFilter& filter, Func f) const {
+		for (size_t g = 0; g < segments.size(); g++) {
+			const SessionSegment& seg = segments[g];
+			if (!filter.mayMatch(seg.zone)) {
+				stats.segmentsSkipped++;
+				continue;
+			}
+			if (filter.coversAll(seg.zone)) {
+				stats.segmentsFullMatch++;
+				for (int i = 0; i < seg.size(); i++)
+					f(g, i);
+				continue;
+			}
+			stats.segmentsScanned++;
+			stats.rowsScanned += seg.size();
+			for (int i = 0; i < seg.size(); i++) {
+				if (filter.matches(seg, i))
+					f(g, i);
+			}
+		}
+	}
+
+public:
+	void append(const Session& s) {
+		if (segments.empty() || segments.back().size() >= SEGMENT_SIZE) {
+			segments.push_back(SessionSegment());
+		}
+		SessionSegment& seg = segments.back();
+		seg.descriptions.push_back(s.description);
+		seg.hours.push_back(s.hours);
+		seg.costs.push_back(s.cost);
+		seg.difficulties.push_back(s.difficulty);
+		seg.timestamps.push_back(s.timestamp);
+		seg.projectIds.push_back(s.projectId);
+
+		ZoneMap& z = seg.zone;
+		z.minHours = min(z.minHours, s.hours);
+		z.maxHours = max(z.maxHours, s.hours);
+		z.minCost = min(z.minCost, s.cost);
+		z.maxCost = max(z.maxCost, s.cost);
+		z.difficultyMask |= 1 << s.difficulty;
+		z.minTime = min(z.minTime, s.timestamp);
+		z.maxTime = max(z.maxTime, s.timestamp);
+		numRows++;
+	}
+
+	int size() const { return numRows; }
+	int segmentCount() const { return (int)segments.size(); }
+	const SessionSegment& getSegment(int g) const { return segments[g]; }
+
+	Session getSession(int row) const {
+		const SessionSegment& seg = segments[row / SEGMENT_SIZE];
+		int i = row % SEGMENT_SIZE;
+		Session s;
+		s.description = seg.descriptions[i];
+		s.hours = seg.hours[i];
+		s.cost = seg.costs[i];
+		s.difficulty = seg.difficulties[i];
+		s.timestamp = seg.timestamps[i];
+		s.projectId = seg.projectIds[i];
+		return s;
+	}
+
+	vector<unsigned int> select(const SessionFilter& filter) const {
+		vector<unsigned int> rows;
+		scan(filter, [&](size_t g, int i) { rows.push_back((unsigned int)(g * SEGMENT_SIZE + i)); });
+		return rows;
+	}
+
+	SessionTotals totals(const SessionFilter& filter) const {
+		SessionTotals t;
+		scan(filter, [&](size_t g, int i) {
+			t.hours += segments[g].hours[i];
+			t.cost += segments[g].costs[i];
+			t.count++;
+		});
+		return t;
+	}
+
+	const ScanStats& getScanStats() const { return stats; }
+	void resetScanStats() { stats = ScanStats(); }
+};
+
+// Query Plan- filter / group-by / aggregate over the session store
+enum QueryColumn { COL_NONE, COL_DESCRIPTION, COL_HOURS, COL_COST, COL_DIFFICULTY, COL_TIMESTAMP };
+enum CompareOp { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE };
+enum AggregateFunc { AGG_COUNT, AGG_SUM, AGG_AVG, AGG_MIN, AGG_MAX };
+
+struct QueryPredicate {
+	QueryColumn column = COL_NONE;
+	CompareOp op = OP_EQ;
+	double value = 0.0; // numeric columns and difficulty
+	string text;        // description
+};
+
+struct QueryAggregate {
+	AggregateFunc func = AGG_COUNT;
+	QueryColumn column = COL_NONE; // COL_NONE for COUNT(*)
+};
+
+struct QueryPlan {
+	vector<QueryPredicate> where; // ANDed together
+	QueryColumn groupBy = COL_NONE;
+	vector<QueryAggregate> aggregates;
+};
+
+struct QueryResultRow {
+	string group;
+	vector<double> values; // one per aggregate
+};
+
+struct QueryResult {
+	vector<string> columnNames;
+	vector<QueryResultRow> rows;
+};
+
+string columnToString(QueryColumn c) {
+	switch (c) {
+	case COL_DESCRIPTION: return "description";
+	case COL_HOURS: return "hours";
+	case COL_COST: return "cost";
+	case COL_DIFFICULTY: return "difficulty";
+	case COL_TIMESTAMP: return "timestamp";
+	default: return "*";
+	}
+}
+
+string aggregateToString(const QueryAggregate& a) {
+	static const char* names[] = { "COUNT", "SUM", "AVG", "MIN", "MAX" };
+	return string(names[a.func]) + "(" + columnToString(a.column) + ")";
+}
+
+// Query Parser
+// Accepts clauses in any order, for example
+//   WHERE difficulty=HARD AND cost>50 GROUP BY description SUM(hours)
+class QueryParser {
+private:
+	vector<string> tokens;
+	size_t pos = 0;
+	string error;
+
+	static string upper(string s) {
+		for (char& c : s) c = (char)toupper((unsigned char)c);
+		return s;
+	}
+
+	void split(const string& text) {
+		size_t i = 0;
+		while (i < text.size()) {
+			char c = text[i];
+			if (isspace((unsigned char)c)) {
+				i++;
+			}
+			else if (c == '\'' || c == '"') {
+				size_t end = text.find(c, i + 1);
+				if (end == string::npos) end = text.size();
+				tokens.push_back(text.substr(i, end - i)); // keep opening quote as a marker
+				i = end + 1;
+			}
+			else if (c == '<' || c == '>' || c == '!' || c == '=') {
+				if (i + 1 < text.size() && text[i + 1] == '=') {
+					tokens.push_back(text.substr(i, 2));
+					i += 2;
+				}
+				else {
+					tokens.push_back(string(1, c));
+					i++;
+				}
+			}
+			else if (c == '(' || c == ')' || c == ',' || c == '*') {
+				tokens.push_back(string(1, c));
+				i++;
+			}
+			else {
+				size_t start = i;
+				while (i < text.size() && (isalnum((unsigned char)text[i]) || text[i] == '.' || text[i] == '_' || text[i] == '-'))
+					i++;
+				if (i == start) i++; // unknown character becomes its own token
+				tokens.push_back(text.substr(start, i - start));
+			}
+		}
+	}
+
+	bool atEnd() const { return pos >= tokens.size(); }
+	string peek() const { return atEnd() ? "" : upper(tokens[pos]); }
+
+	bool expect(const string& t) {
+		if (peek() != t) {
+			error = "Expected '" + t + "'" + (atEnd() ? " at end" : " near '" + tokens[pos] + "'");
+			return false;
+		}
+		pos++;
+		return true;
+	}
+
+	bool parseColumn(QueryColumn& c) {
+		string t = peek();
+		if (t == "DESCRIPTION") c = COL_DESCRIPTION;
+		else if (t == "HOURS") c = COL_HOURS;
+		else if (t == "COST") c = COL_COST;
+		else if (t == "DIFFICULTY") c = COL_DIFFICULTY;
+		else if (t == "TIMESTAMP") c = COL_TIMESTAMP;
+		else {
+			error = "Unknown column '" + (atEnd() ? string() : tokens[pos]) + "'";
+			return false;
+		}
+		pos++;
+		return true;
+	}
+
+	bool parsePredicate(QueryPlan& plan) {
+		QueryPredicate p;
+		if (!parseColumn(p.column)) return false;
+
+		string op = peek();
+		if (op == "=") p.op = OP_EQ;
+		else if (op == "!=") p.op = OP_NE;
+		else if (op == "<") p.op = OP_LT;
+		else if (op == "<=") p.op = OP_LE;
+		else if (op == ">") p.op = OP_GT;
+		else if (op == ">=") p.op = OP_GE;
+		else {
+			error = "Expected a comparison after " + columnToString(p.column);
+			return false;
+		}
+		pos++;
+
+		if (atEnd()) {
+			error = "Missing value in WHERE";
+			return false;
+		}
+		string raw = tokens[pos++];
+		string value = upper(raw);
+		if (p.column == COL_DESCRIPTION) {
+			if (p.op != OP_EQ && p.op != OP_NE) {
+				error = "description only supports = and !=";
+				return false;
+			}
+			p.text = (raw[0] == '\'' || raw[0] == '"') ? raw.substr(1) : raw;
+		}
+		else if (p.column == COL_DIFFICULTY && (value == "EASY" || value == "INTERMEDIATE" || value == "HARD")) {
+			p.value = (value == "EASY") ? EASY : (value == "INTERMEDIATE") ? INTERMEDIATE : HARD;
+		}
+		else {
+			char* end = nullptr;
+			p.value = strtod(raw.c_str(), &end);
+			if (end == raw.c_str() || *end != '\0') {
+				error = "Bad number '" + raw + "'";
+				return false;
+			}
+			// Integer columns take whole numbers that fit, never a rounded value
+			if (p.column == COL_DIFFICULTY && !(p.value >= EASY && p.value <= HARD && floor(p.value) == p.value)) {
+				error = "Difficulty must be EASY, INTERMEDIATE or HARD (" + to_string((int)EASY) + "-" + to_string((int)HARD) + ")";
+				return false;
+			}
+			if (p.column == COL_TIMESTAMP && !(p.value >= -9223372036854775808.0 && p.value < 9223372036854775808.0 && floor(p.value) == p.value)) {
+				error = "Timestamp must be a whole number of seconds";
+				return false;
+			}
+		}
+		plan.where.push_back(p);
+		return true;
+	}
+
+	bool parseAggregate(QueryPlan& plan) {
+		QueryAggregate a;
+		string f = peek();
+		if (f == "COUNT") a.func = AGG_COUNT;
+		else if (f == "SUM") a.func = AGG_SUM;
+		else if (f == "AVG") a.func = AGG_AVG;
+		else if (f == "MIN") a.func = AGG_MIN;
+		else if (f == "MAX") a.func = AGG_MAX;
+		pos++;
+		if (!expect("(")) return false;
+		if (peek() == "*" && a.func == AGG_COUNT) {
+			pos++;
+		}
+		else {
+			if (!parseColumn(a.column)) return false;
+			if (a.column == COL_DESCRIPTION) {
+				error = "Cannot aggregate description";
+				return false;
+			}
+		}
+		if (!expect(")")) return false;
+		plan.aggregates.push_back(a);
+		return true;
+	}
+
+public:
+	bool parse(const string& text, QueryPlan& plan) {
+		tokens.clear();
+		pos = 0;
+		error.clear();
+		plan = QueryPlan();
+		split(text);
+
+		while (!atEnd()) {
+			string t = peek();
+			if (t == "SELECT" || t == ",") {
+				pos++;
+			}
+			else if (t == "WHERE") {
+				pos++;
+				if (!parsePredicate(plan)) return false;
+				while (peek() == "AND") {
+					pos++;
+					if (!parsePredicate(plan)) return false;
+				}
+			}
+			else if (t == "GROUP") {
+				pos++;
+				if (!expect("BY") || !parseColumn(plan.groupBy)) return false;
+			}
+			else if (t == "COUNT" || t == "SUM" || t == "AVG" || t == "MIN" || t == "MAX") {
+				if (!parseAggregate(plan)) return false;
+			}
+			else {
+				error = "Unexpected '" + tokens[pos] + "'";
+				return false;
+			}
+		}
+		if (plan.aggregates.empty()) {
+			QueryAggregate countAll;
+			plan.aggregates.push_back(countAll);
+		}
+		return true;
+	}
+
+	const string& getError() const { return error; }
+};
+
+// Query Engine- runs a plan one segment (batch) at a time
+// Each predicate narrows a selection vector of row positions with a tight
+// loop over one column, then the surviving rows are aggregated per group.
+class QueryEngine {
+private:
+	struct AggState {
+		double sum = 0.0;
+		double minValue = numeric_limits<double>::infinity();
+		double maxValue = -numeric_limits<double>::infinity();
+		long long count = 0;
+	};
+
+	template <typename T>
+	static bool compare(T a, CompareOp op, T b) {
+		switch (op) {
+		case OP_EQ: return a == b;
+		case OP_NE: return a != b;
+		case OP_LT: return a < b;
+		case OP_LE: return a <= b;
+		case OP_GT: return a > b;
+		default: return a >= b;
+		}
+	}
+
+	// Keeps the positions in sel[0..n) whose column value passes; returns the new count
+	template <typename T, typename Cmp>
+	static int filterColumn(const T* column, int* sel, int n, Cmp pass) {
+		int kept = 0;
+		for (int k = 0; k < n; k++) {
+			int i = sel[k];
+			sel[kept] = i;
+			kept += pass(column[i]) ? 1 : 0;
+		}
+		return kept;
+	}
+
+	template <typename T>
+	static int filterNumeric(const T* column, int* sel, int n, CompareOp op, T value) {
+		switch (op) {
+		case OP_EQ: return filterColumn(column, sel, n, [value](T v) { return v == value; });
+		case OP_NE: return filterColumn(column, sel, n, [value](T v) { return v != value; });
+		case OP_LT: return filterColumn(column, sel, n, [value](T v) { return v < value; });
+		case OP_LE: return filterColumn(column, sel, n, [value](T v) { return v <= value; });
+		case OP_GT: return filterColumn(column, sel, n, [value](T v) { return v > value; });
+		default: return filterColumn(column, sel, n, [value](T v) { return v >= value; });
+		}
+	}
+
+	// Segment-level pruning: only numeric predicates that a zone map can rule out
+	static bool segmentMayMatch(const QueryPlan& plan, const ZoneMap& z) {
+		for (const QueryPredicate& p : plan.where) {
+			double lo, hi;
+			if (p.column == COL_HOURS) { lo = z.minHours; hi = z.maxHours; }
+			else if (p.column == COL_COST) { lo = z.minCost; hi = z.maxCost; }
+			else if (p.column == COL_TIMESTAMP) { lo = (double)z.minTime; hi = (double)z.maxTime; }
+			else if (p.column == COL_DIFFICULTY) {
+				if (p.op == OP_EQ && !(z.difficultyMask & (1 << (int)p.value))) return false;
+				continue;
+			}
+			else continue;
+
+			if ((p.op == OP_EQ && (p.value < lo || p.value > hi))
+				|| (p.op == OP_LT && lo >= p.value) || (p.op == OP_LE && lo > p.value)
+				|| (p.op == OP_GT && hi <= p.value) || (p.op == OP_GE && hi < p.value))
+				return false;
+		}
+		return true;
+	}
+
+public:
+	static QueryResult execute(const SessionStore& store, const QueryPlan& plan) {
+		QueryResult result;
+		for (const QueryAggregate& a : plan.aggregates)
+			result.columnNames.push_back(aggregateToString(a));
+
+		size_t numAggs = plan.aggregates.size();
+		vector<string> groupNames;
+		vector<AggState> states; // groupNames.size() * numAggs
+		unordered_map<string, int> groupIds;
+		int sel[SEGMENT_SIZE];
+		int groupOf[SEGMENT_SIZE];
+
+		auto groupFor = [&](const string& name) {
+			auto it = groupIds.find(name);
+			if (it != groupIds.end()) return it->second;
+			int id = (int)groupNames.size();
+			groupIds[name] = id;
+			groupNames.push_back(name);
+			states.resize(states.size() + numAggs);
+			return id;
+		};
+
+		for (int g = 0; g < store.segmentCount(); g++) {
+			const SessionSegment& seg = store.getSegment(g);
+			if (!segmentMayMatch(plan, seg.zone)) continue;
+
+			int n = seg.size();
+			for (int i = 0; i < n; i++) sel[i] = i;
+
+			for (size_t w = 0; w < plan.where.size() && n > 0; w++) {
+				const QueryPredicate& p = plan.where[w];
+				switch (p.column) {
+				case COL_HOURS: n = filterNumeric(seg.hours.data(), sel, n, p.op, p.value); break;
+				case COL_COST: n = filterNumeric(seg.costs.data(), sel, n, p.op, p.value); break;
+				case COL_TIMESTAMP: n = filterNumeric(seg.timestamps.data(), sel, n, p.op, (long long)p.value); break;
+				case COL_DIFFICULTY: {
+					int d = (int)p.value;
+					CompareOp op = p.op;
+					n = filterColumn(seg.difficulties.data(), sel, n,
+						[d, op](DifficultyLevel v) { return compare((int)v, op, d); });
+					break;
+				}
+				case COL_DESCRIPTION: {
+					bool equal = (p.op == OP_EQ);
+					const string& text = p.text;
+					n = filterColumn(seg.descriptions.data(), sel, n,
+						[&text, equal](const string& v) { return (v == text) == equal; });
+					break;
+				}
+				default: break;
+				}
+			}
+			if (n == 0) continue;
+
+			// Group ids for the selected rows
+			for (int k = 0; k < n; k++) {
+				int i = sel[k];
+				if (plan.groupBy == COL_DESCRIPTION) groupOf[k] = groupFor(seg.descriptions[i]);
+				else if (plan.groupBy == COL_DIFFICULTY) groupOf[k] = groupFor(difficultyToString(seg.difficulties[i]));
+				else if (plan.groupBy == COL_NONE) groupOf[k] = groupFor("");
+				else {
+					ostringstream key;
+					key << (plan.groupBy == COL_HOURS ? seg.hours[i]
+						: plan.groupBy == COL_COST ? seg.costs[i] : (double)seg.timestamps[i]);
+					groupOf[k] = groupFor(key.str());
+				}
+			}
+
+			// One pass per aggregate over the selection vector
+			for (size_t a = 0; a < numAggs; a++) {
+				QueryColumn col = plan.aggregates[a].column;
+				const double* values = (col == COL_HOURS) ? seg.hours.data()
+					: (col == COL_COST) ? seg.costs.data() : nullptr;
+				for (int k = 0; k < n; k++) {
+					int i = sel[k];
+					double v = values ? values[i]
+						: (col == COL_DIFFICULTY) ? (double)seg.difficulties[i]
+						: (col == COL_TIMESTAMP) ? (double)seg.timestamps[i] : 1.0;
+					AggState& st = states[groupOf[k] * numAggs + a];
+					st.sum += v;
+					st.minValue = min(st.minValue, v);
+					st.maxValue = max(st.maxValue, v);
+					st.count++;
+				}
+			}
+		}
+
+		for (size_t gi = 0; gi < groupNames.size(); gi++) {
+			QueryResultRow row;
+			row.group = groupNames[gi];
+			for (size_t a = 0; a < numAggs; a++) {
+				const AggState& st = states[gi * numAggs + a];
+				switch (plan.aggregates[a].func) {
+				case AGG_COUNT: row.values.push_back((double)st.count); break;
+				case AGG_SUM: row.values.push_back(st.sum); break;
+				case AGG_AVG: row.values.push_back(st.count ? st.sum / st.count : 0.0); break;
+				case AGG_MIN: row.values.push_back(st.minValue); break;
+				case AGG_MAX: row.values.push_back(st.maxValue); break;
+				}
+			}
+			result.rows.push_back(row);
+		}
+		sort(result.rows.begin(), result.rows.end(),
+			[](const QueryResultRow& x, const QueryResultRow& y) { return x.group < y.group; });
+		return result;
+	}
+};
+
+// Group Stats- count, sum, min and max of hours and cost
+struct GroupStats {
+	int count = 0;
+	double hoursSum = 0.0;
+	double hoursMin = 0.0;
+	double hoursMax = 0.0;
+	double costSum = 0.0;
+	double costMin = 0.0;
+	double costMax = 0.0;
+
+	void add(double hours, double cost) {
+		if (count == 0) {
+			hoursMin = hoursMax = hours;
+			costMin = costMax = cost;
+		}
+		else {
+			hoursMin = min(hoursMin, hours);
+			hoursMax = max(hoursMax, hours);
+			costMin = min(costMin, cost);
+			costMax = max(costMax, cost);
+		}
+		hoursSum += hours;
+		costSum += cost;
+		count++;
+	}
+
+	double meanHours() const { return count ? hoursSum / count : 0.0; }
+	double meanCost() const { return count ? costSum / count : 0.0; }
+};
+
+// Dashboard Stats- per difficulty and overall, built in one pass
+struct DashboardStats {
+	GroupStats byDifficulty[HARD_VALUE + 1]; // indexed by DifficultyLevel
+	GroupStats overall;
+
+	DifficultyLevel hardest() const {
+		if (byDifficulty[HARD].count > 0) return HARD;
+		if (byDifficulty[INTERMEDIATE].count > 0) return INTERMEDIATE;
+		return EASY;
+	}
+};
+
+void writeStats(ostream& out, const DashboardStats& stats) {
+	out << left << setw(15) << "Difficulty"
+		<< setw(8) << "Count"
+		<< setw(10) << "Hours"
+		<< setw(10) << "Avg Hrs"
+		<< setw(10) << "Min Hrs"
+		<< setw(10) << "Max Hrs"
+		<< setw(10) << "Cost"
+		<< setw(10) << "Avg Cost"
+		<< setw(10) << "Min Cost"
+		<< setw(10) << "Max Cost" << endl;
+
+	for (int d = EASY; d <= HARD + 1; d++) {
+		const GroupStats& g = (d <= HARD) ? stats.byDifficulty[d] : stats.overall;
+		out << left << setw(15) << ((d <= HARD) ? difficultyToString((DifficultyLevel)d) : "All")
+			<< setw(8) << g.count
+			<< fixed << setprecision(1)
+			<< setw(10) << g.hoursSum
+			<< setw(10) << g.meanHours()
+			<< setw(10) << g.hoursMin
+			<< setw(10) << g.hoursMax
+			<< setprecision(2)
+			<< setw(10) << g.costSum
+			<< setw(10) << g.meanCost()
+			<< setw(10) << g.costMin
+			<< setw(10) << g.costMax << endl;
+	}
+}
+
+// Quantile Sketch- KLL-style mergeable sketch
+// Level h holds values that each stand for 2^h inserted values. When a level
+// is full it is sorted and every other value moves up a level, so memory
+// stays around a few times k no matter how many values are added.
+class QuantileSketch {
+private:
+	int k;
+	long long n = 0;
+	vector<vector<double>> levels;
+	unsigned long long rngState = 0x9E3779B97F4A7C15ULL;
+
+	bool randomBit() {
+		rngState ^= rngState << 13;
+		rngState ^= rngState >> 7;
+		rngState ^= rngState << 17;
+		return (rngState & 1ULL) != 0;
+	}
+
+	size_t capacity(size_t h) const {
+		size_t depth = levels.size() - 1 - h;
+		double cap = k * pow(2.0 / 3.0, (double)depth);
+		return max((size_t)2, (size_t)ceil(cap));
+	}
+
+	void compress() {
+		for (size_t h = 0; h < levels.size(); h++) {
+			if (levels[h].size() < capacity(h)) continue;
+			if (h + 1 == levels.size())
+				levels.push_back(vector<double>());
+
+			vector<double>& level = levels[h];
+			sort(level.begin(), level.end());
+			double leftover = 0.0;
+			bool hasLeftover = (level.size() % 2) == 1;
+			if (hasLeftover) {
+				leftover = level.back();
+				level.pop_back();
+			}
+			size_t offset = randomBit() ? 1 : 0;
+			for (size_t i = offset; i < level.size(); i += 2)
+				levels[h + 1].push_back(level[i]);
+			level.clear();
+			if (hasLeftover)
+				level.push_back(leftover);
+		}
+	}
+
+public:
+	QuantileSketch(int accuracy = 200) : k(accuracy), levels(1) {}
+
+	void add(double x) {
+		levels[0].push_back(x);
+		n++;
+		if (levels[0].size() >= capacity(0))
+			compress();
+	}
+
+	// Combine another sketch (e.g. another user's or shard's) into this one
+	void merge(const QuantileSketch& other) {
+		if (other.levels.size() > levels.size())
+			levels.resize(other.levels.size());
+		for (size_t h = 0; h < other.levels.size(); h++)
+			levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+		n += other.n;
+		compress();
+	}
+
+	long long count() const { return n; }
+
+	size_t retained() const {
+		size_t total = 0;
+		for (const vector<double>& level : levels)
+			total += level.size();
+		return total;
+	}
+
+	// Approximate value at rank q (0 = minimum, 1 = maximum)
+	double quantile(double q) const {
+		vector<pair<double, long long>> weighted;
+		for (size_t h = 0; h < levels.size(); h++)
+			for (double v : levels[h])
+				weighted.push_back({ v, 1LL << h });
+		if (weighted.empty()) return 0.0;
+		sort(weighted.begin(), weighted.end());
+
+		long long total = 0;
+		for (const pair<double, long long>& w : weighted)
+			total += w.second;
+		double target = q * (double)total;
+		long long seen = 0;
+		for (const pair<double, long long>& w : weighted) {
+			seen += w.second;
+			if ((double)seen >= target)
+				return w.first;
+		}
+		return weighted.back().first;
+	}
+};
+
+// Top-K- the K largest sessions by one column, kept in a min-heap
+enum SessionKey { KEY_HOURS, KEY_COST };
+
+class TopKSessions {
+private:
+	SessionKey key;
+	int k;
+	vector<Session> heap; // smallest kept session at the front
+
+	double keyOf(const Session& s) const {
+		return (key == KEY_HOURS) ? s.hours : s.cost;
+	}
+
+	// Orders the heap so the smallest key is on top
+	bool greaterKey(const Session& a, const Session& b) const {
+		return keyOf(a) > keyOf(b);
+	}
+
+public:
+	TopKSessions(SessionKey sortKey = KEY_COST, int count = TOP_K)
+		: key(sortKey), k(count) {}
+
+	void add(const Session& s) {
+		auto cmp = [this](const Session& a, const Session& b) { return greaterKey(a, b); };
+		if ((int)heap.size() < k) {
+			heap.push_back(s);
+			push_heap(heap.begin(), heap.end(), cmp);
+		}
+		else if (k > 0 && keyOf(s) > keyOf(heap.front())) {
+			pop_heap(heap.begin(), heap.end(), cmp);
+			heap.back() = s;
+			push_heap(heap.begin(), heap.end(), cmp);
+		}
+	}
+
+	void merge(const TopKSessions& other) {
+		for (const Session& s : other.heap)
+			add(s);
+	}
+
+	int size() const { return (int)heap.size(); }
+
+	// Largest first
+	vector<Session> getSorted() const {
+		vector<Session> sorted = heap;
+		sort(sorted.begin(), sorted.end(),
+			[this](const Session& a, const Session& b) { return greaterKey(a, b); });
+		return sorted;
+	}
+
+	// Combines many lists (e.g. one per user) pairwise, each round in parallel
+	static TopKSessions mergeAll(vector<TopKSessions> lists) {
+		if (lists.empty()) return TopKSessions();
+		while (lists.size() > 1) {
+			size_t half = (lists.size() + 1) / 2;
+			vector<thread> workers;
+			for (size_t i = 0; i + half < lists.size(); i++)
+				workers.emplace_back([&lists, i, half]() { lists[i].merge(lists[i + half]); });
+			for (thread& t : workers)
+				t.join();
+			lists.resize(half);
+		}
+		return lists[0];
+	}
+};
+
+// Sorted Views- row orderings that leave the sessions where they are
+enum SortColumn { SORT_HOURS, SORT_COST, SORT_DIFFICULTY, SORT_DESCRIPTION };
+const int NUM_SORT_COLUMNS = 4;
+
+// Unsigned key with the same ordering as the double
+unsigned long long sortableKey(double v) {
+	unsigned long long bits;
+	memcpy(&bits, &v, sizeof(bits));
+	const unsigned long long signBit = 1ULL << 63;
+	return (bits & signBit) ? ~bits : (bits | signBit);
+}
+
+// Stable LSD radix sort of row ids by key, one byte per pass.
+// Passes where every key has the same byte are skipped, so small keys
+// like difficulty only cost a single pass.
+vector<unsigned int> radixSortRows(const vector<unsigned long long>& keys) {
+	size_t n = keys.size();
+	vector<unsigned int> rows(n), scratch(n);
+	for (size_t i = 0; i < n; i++)
+		rows[i] = (unsigned int)i;
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t counts[257] = {};
+		for (size_t i = 0; i < n; i++)
+			counts[((keys[i] >> shift) & 0xFF) + 1]++;
+
+		bool allSame = false;
+		for (int b = 1; b <= 256; b++)
+			if (counts[b] == n) allSame = true;
+		if (allSame) continue;
+
+		for (int b = 1; b <= 256; b++)
+			counts[b] += counts[b - 1];
+		for (size_t i = 0; i < n; i++) {
+			unsigned int row = rows[i];
+			scratch[counts[(keys[row] >> shift) & 0xFF]++] = row;
+		}
+		rows.swap(scratch);
+	}
+	return rows;
+}
+
+// Cached permutation per column, rebuilt after new sessions arrive
+class SortedViewCache {
+private:
+	vector<unsigned int> orders[NUM_SORT_COLUMNS];
+	bool valid[NUM_SORT_COLUMNS] = {};
+
+public:
+	void invalidate() {
+		for (int c = 0; c < NUM_SORT_COLUMNS; c++)
+			valid[c] = false;
+	}
+
+	const vector<unsigned int>& get(SortColumn column, const Session* sessions, int count) {
+		if (valid[column]) return orders[column];
+
+		if (column == SORT_DESCRIPTION) {
+			vector<unsigned int> rows(count);
+			for (int i = 0; i < count; i++)
+				rows[i] = (unsigned int)i;
+			stable_sort(rows.begin(), rows.end(), [sessions](unsigned int a, unsigned int b) {
+				return sessions[a].description < sessions[b].description;
+			});
+			orders[column] = rows;
+		}
+		else {
+			vector<unsigned long long> keys(count);
+			for (int i = 0; i < count; i++) {
+				if (column == SORT_HOURS) keys[i] = sortableKey(sessions[i].hours);
+				else if (column == SORT_COST) keys[i] = sortableKey(sessions[i].cost);
+				else keys[i] = (unsigned long long)sessions[i].difficulty;
+			}
+			orders[column] = radixSortRows(keys);
+		}
+		valid[column] = true;
+		return orders[column];
+	}
+};
+
+// Rule Engine- recommendation rules compiled to stack bytecode
+// A rules file has one rule per line:
+//   if weekHours >= goal and weekCost <= maxCostGood then Great job!
+// Rules are checked top to bottom and the first match wins. Blank lines
+// and lines starting with '#' are ignored.
+enum RuleVar {
+	VAR_WEEK_HOURS, VAR_WEEK_COST, VAR_WEEK_SESSIONS,
+	VAR_MONTH_HOURS, VAR_MONTH_COST,
+	VAR_TOTAL_HOURS, VAR_TOTAL_COST, VAR_AVERAGE_HOURS, VAR_SESSIONS,
+	VAR_HARDEST, VAR_GOAL, VAR_MIN_HOURS_GOOD, VAR_MAX_COST_GOOD,
+	NUM_RULE_VARS
+};
+
+const char* RULE_VAR_NAMES[NUM_RULE_VARS] = {
+	"weekHours", "weekCost", "weekSessions",
+	"monthHours", "monthCost",
+	"totalHours", "totalCost", "averageHours", "sessions",
+	"hardest", "goal", "minHoursGood", "maxCostGood"
+};
+
+// Values the rules can read, filled in once per evaluation
+struct RuleContext {
+	double values[NUM_RULE_VARS] = {};
+};
+
+enum RuleOp : unsigned char {
+	RULE_PUSH, RULE_LOAD,
+	RULE_ADD, RULE_SUB, RULE_MUL, RULE_DIV,
+	RULE_LT, RULE_LE, RULE_GT, RULE_GE, RULE_EQ, RULE_NE,
+	RULE_AND, RULE_OR, RULE_NOT
+};
+
+struct RuleInstruction {
+	RuleOp op;
+	unsigned short arg; // constant index for PUSH, variable for LOAD
+};
+
+struct CompiledRule {
+	vector<RuleInstruction> code;
+	string message;
+};
+
+class RuleSet {
+private:
+	static const int MAX_STACK = 32;
+
+	vector<CompiledRule> rules;
+	vector<double> constants; // shared by all rules
+
+	// Recursive descent compiler for one expression
+	class Compiler {
+	private:
+		const string& text;
+		size_t pos = 0;
+		int depth = 0;
+		int maxDepth = 0;
+		RuleSet& owner;
+		vector<RuleInstruction>& code;
+
+		void skipSpaces() {
+			while (pos < text.size() && isspace((unsigned char)text[pos])) pos++;
+		}
+
+		string peekWord() {
+			skipSpaces();
+			size_t end = pos;
+			while (end < text.size() && (isalnum((unsigned char)text[end]) || text[end] == '_')) end++;
+			return text.substr(pos, end - pos);
+		}
+
+		bool acceptWord(const string& w) {
+			if (peekWord() != w) return false;
+			pos += w.size();
+			return true;
+		}
+
+		bool acceptSymbol(const string& sym) {
+			skipSpaces();
+			if (text.compare(pos, sym.size(), sym) != 0) return false;
+			pos += sym.size();
+			return true;
+		}
+
+		void emit(RuleOp op, int arg = 0) {
+			code.push_back({ op, (unsigned short)arg });
+			if (op == RULE_PUSH || op == RULE_LOAD) depth++;
+			else if (op != RULE_NOT) depth--;
+			maxDepth = max(maxDepth, depth);
+		}
+
+		bool atom() {
+			skipSpaces();
+			if (acceptSymbol("(")) {
+				if (!orExpr()) return false;
+				if (!acceptSymbol(")")) return fail("expected ')'");
+				return true;
+			}
+			if (pos < text.size() && (isdigit((unsigned char)text[pos]) || text[pos] == '.')) {
+				char* end = nullptr;
+				double v = strtod(text.c_str() + pos, &end);
+				pos = end - text.c_str();
+				emit(RULE_PUSH, owner.addConstant(v));
+				return true;
+			}
+
+			string word = peekWord();
+			if (word.empty()) return fail("expected a value");
+			pos += word.size();
+			if (word == "true" || word == "false") {
+				emit(RULE_PUSH, owner.addConstant(word == "true" ? 1.0 : 0.0));
+				return true;
+			}
+			if (word == "easy" || word == "intermediate" || word == "hard") {
+				emit(RULE_PUSH, owner.addConstant(word == "easy" ? EASY : word == "intermediate" ? INTERMEDIATE : HARD));
+				return true;
+			}
+			for (int v = 0; v < NUM_RULE_VARS; v++) {
+				if (word == RULE_VAR_NAMES[v]) {
+					emit(RULE_LOAD, v);
+					return true;
+				}
+			}
+			return fail("unknown name '" + word + "'");
+		}
+
+		bool term() {
+			if (!atom()) return false;
+			while (true) {
+				if (acceptSymbol("*")) { if (!atom()) return false; emit(RULE_MUL); }
+				else if (acceptSymbol("/")) { if (!atom()) return false; emit(RULE_DIV); }
+				else return true;
+			}
+		}
+
+		bool sum() {
+			if (!term()) return false;
+			while (true) {
+				if (acceptSymbol("+")) { if (!term()) return false; emit(RULE_ADD); }
+				else if (acceptSymbol("-")) { if (!term()) return false; emit(RULE_SUB); }
+				else return true;
+			}
+		}
+
+		bool comparison() {
+			if (!sum()) return false;
+			static const pair<const char*, RuleOp> ops[] = {
+				{ "<=", RULE_LE }, { ">=", RULE_GE }, { "==", RULE_EQ }, { "!=", RULE_NE },
+				{ "<", RULE_LT }, { ">", RULE_GT }
+			};
+			for (const auto& op : ops) {
+				if (acceptSymbol(op.first)) {
+					if (!sum()) return false;
+					emit(op.second);
+					return true;
+				}
+			}
+			return true;
+		}
+
+		bool notExpr() {
+			if (acceptWord("not")) {
+				if (!notExpr()) return false;
+				emit(RULE_NOT);
+				return true;
+			}
+			return comparison();
+		}
+
+		bool andExpr() {
+			if (!notExpr()) return false;
+			while (acceptWord("and")) {
+				if (!notExpr()) return false;
+				emit(RULE_AND);
+			}
+			return true;
+		}
+
+		bool orExpr() {
+			if (!andExpr()) return false;
+			while (acceptWord("or")) {
+				if (!andExpr()) return false;
+				emit(RULE_OR);
+			}
+			return true;
+		}
+
+		bool fail(const string& message) {
+			error = message;
+			return false;
+		}
+
+	public:
+		string error;
+
+		Compiler(const string& t, RuleSet& o, vector<RuleInstruction>& c)
+			: text(t), owner(o), code(c) {}
+
+		// Compiles up to the word 'then'; returns the text after it in rest
+		bool compile(string& rest) {
+			if (!orExpr()) return false;
+			if (!acceptWord("then")) return fail("expected 'then'");
+			if (maxDepth > MAX_STACK) return fail("expression too deep");
+			skipSpaces();
+			rest = text.substr(pos);
+			if (rest.empty()) return fail("missing message after 'then'");
+			return true;
+		}
+	};
+
+	int addConstant(double v) {
+		for (size_t i = 0; i < constants.size(); i++)
+			if (constants[i] == v) return (int)i;
+		constants.push_back(v);
+		return (int)constants.size() - 1;
+	}
+
+	bool run(const vector<RuleInstruction>& code, const RuleContext& ctx) const {
+		double stack[MAX_STACK];
+		int top = 0;
+		for (const RuleInstruction& in : code) {
+			switch (in.op) {
+			case RULE_PUSH: stack[top++] = constants[in.arg]; break;
+			case RULE_LOAD: stack[top++] = ctx.values[in.arg]; break;
+			case RULE_NOT: stack[top - 1] = (stack[top - 1] == 0.0) ? 1.0 : 0.0; break;
+			default: {
+				double b = stack[--top];
+				double& a = stack[top - 1];
+				switch (in.op) {
+				case RULE_ADD: a = a + b; break;
+				case RULE_SUB: a = a - b; break;
+				case RULE_MUL: a = a * b; break;
+				case RULE_DIV: a = (b == 0.0) ? 0.0 : a / b; break;
+				case RULE_LT: a = (a < b); break;
+				case RULE_LE: a = (a <= b); break;
+				case RULE_GT: a = (a > b); break;
+				case RULE_GE: a = (a >= b); break;
+				case RULE_EQ: a = (a == b); break;
+				case RULE_NE: a = (a != b); break;
+				case RULE_AND: a = (a != 0.0 && b != 0.0); break;
+				case RULE_OR: a = (a != 0.0 || b != 0.0); break;
+				default: break;
+				}
+			}
+			}
+		}
+		return top > 0 && stack[top - 1] != 0.0;
+	}
+
+public:
+	// Replaces the current rules; on error the rule set is left unchanged
+	bool load(istream& in, string& error) {
+		RuleSet compiled;
+		string line;
+		int lineNumber = 0;
+		while (getline(in, line)) {
+			lineNumber++;
+			size_t start = line.find_first_not_of(" \t\r");
+			if (start == string::npos || line[start] == '#') continue;
+			line = line.substr(start);
+			while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+				line.pop_back();
+
+			if (line.compare(0, 3, "if ") != 0) {
+				error = "line " + to_string(lineNumber) + ": rules must start with 'if'";
+				return false;
+			}
+			string body = line.substr(3);
+			CompiledRule rule;
+			Compiler compiler(body, compiled, rule.code);
+			if (!compiler.compile(rule.message)) {
+				error = "line " + to_string(lineNumber) + ": " + compiler.error;
+				return false;
+			}
+			compiled.rules.push_back(rule);
+		}
+		*this = compiled;
+		return true;
+	}
+
+	bool loadText(const string& text, string& error) {
+		istringstream in(text);
+		return load(in, error);
+	}
+
+	int size() const { return (int)rules.size(); }
+
+	// Message of the first matching rule, or "" when none match
+	string evaluate(const RuleContext& ctx) const {
+		for (const CompiledRule& rule : rules)
+			if (run(rule.code, ctx))
+				return rule.message;
+		return "";
+	}
+};
+
+// Built-in rules, used when there is no rules file
+const char* DEFAULT_RULES =
+	"if weekHours >= goal and weekCost <= maxCostGood then Great job! You met your weekly goal AND stayed on budget.\n"
+	"if weekHours < goal and weekCost > maxCostGood then You may want shorter sessions or lower-cost projects.\n"
+	"if true then You are making steady progress. Keep going!\n";
+
+// Project Session Index- sessions grouped by project (CSR layout)
+// Sessions for project p are rows[offsets[p]] .. rows[offsets[p + 1] - 1].
+class ProjectSessionIndex {
+private:
+	vector<int> offsets;
+	vector<unsigned int> rows;
+
+public:
+	void build(const Session* sessions, int numSessions, int numProjects) {
+		offsets.assign(numProjects + 1, 0);
+		for (int i = 0; i < numSessions; i++) {
+			int p = sessions[i].projectId;
+			if (p >= 0 && p < numProjects) offsets[p + 1]++;
+		}
+		for (int p = 0; p < numProjects; p++)
+			offsets[p + 1] += offsets[p];
+
+		rows.assign(offsets[numProjects], 0);
+		vector<int> next(offsets.begin(), offsets.end() - 1);
+		for (int i = 0; i < numSessions; i++) {
+			int p = sessions[i].projectId;
+			if (p >= 0 && p < numProjects) rows[next[p]++] = (unsigned int)i;
+		}
+	}
+
+	int projectCount() const { return offsets.empty() ? 0 : (int)offsets.size() - 1; }
+
+	vector<unsigned int> sessionsFor(int projectId) const {
+		if (projectId < 0 || projectId >= projectCount()) return vector<unsigned int>();
+		return vector<unsigned int>(rows.begin() + offsets[projectId], rows.begin() + offsets[projectId + 1]);
+	}
+};
+
+// Project Progress- logged work compared with the project's estimate
+struct ProjectProgress {
+	int sessions = 0;
+	double actualHours = 0.0;
+	double actualCost = 0.0;
+	double estimatedHours = 0.0; // getDuration() is in minutes
+	double estimatedCost = 0.0;
+};
+
+// Derived Results- cached totals and recommendation for one tracker version
+struct DerivedResults {
+	bool valid = false;
+	unsigned long long version = 0;
+	double totalHours = 0.0;
+	double totalCost = 0.0;
+	double averageHours = 0.0;
+	DifficultyLevel hardest = EASY;
+
+	// recommendation also depends on the goal and the current week and month
+	bool hasRecommendation = false;
+	double recommendationGoal = 0.0;
+	long long recommendationWeek = 0;
+	long long recommendationMonth = 0;
+	string recommendation;
+};
+
+// Storage Layouts- where a tracker keeps its sessions
+template <int N>
+struct FixedSessionStorage {
+	static constexpr int capacity = N;
+	Session items[N];
+	int count = 0;
+
+	void push(const Session& s) { items[count++] = s; }
+	Session& operator[](int i) { return items[i]; }
+	const Session& operator[](int i) const { return items[i]; }
+	const Session* data() const { return items; }
+};
+
+struct DynamicSessionStorage {
+	static constexpr int capacity = -1; // grows as needed
+	vector<Session> items;
+
+	void push(const Session& s) { items.push_back(s); }
+	Session& operator[](int i) { return items[i]; }
+	const Session& operator[](int i) const { return items[i]; }
+	const Session* data() const { return items.data(); }
+};
+
+// Tracker Policies- limits and storage chosen at compile time
+struct DefaultTrackerPolicy {
+	using Storage = FixedSessionStorage<MAX_SESSIONS>;
+	static constexpr bool runtimeLimits = false;
+	static constexpr int maxSessions = MAX_SESSIONS;
+	static constexpr double minHoursGood = MIN_HOURS_GOOD;
+	static constexpr double maxCostGood = MAX_COST_GOOD;
+};
+
+// Larger shop tier with its own thresholds
+struct StudioTrackerPolicy {
+	using Storage = FixedSessionStorage<500>;
+	static constexpr bool runtimeLimits = false;
+	static constexpr int maxSessions = 500;
+	static constexpr double minHoursGood = 10.0;
+	static constexpr double maxCostGood = 200.0;
+};
+
+// Limits read from TrackerLimits at run time; the constants are defaults
+struct RuntimeTrackerPolicy {
+	using Storage = DynamicSessionStorage;
+	static constexpr bool runtimeLimits = true;
+	static constexpr int maxSessions = MAX_SESSIONS;
+	static constexpr double minHoursGood = MIN_HOURS_GOOD;
+	static constexpr double maxCostGood = MAX_COST_GOOD;
+};
+
+struct TrackerLimits {
+	int maxSessions = MAX_SESSIONS;
+	double minHoursGood = MIN_HOURS_GOOD;
+	double maxCostGood = MAX_COST_GOOD;
+};
+
+// New Class- Week 2
+template <class Policy>
+class BasicEmbroideryTracker {
+	using Storage = typename Policy::Storage;
+
+	static_assert(Policy::maxSessions > 0, "maxSessions must be positive");
+	static_assert(Storage::capacity < 0 || Storage::capacity >= Policy::maxSessions,
+		"storage is smaller than maxSessions");
+	static_assert(Policy::minHoursGood >= 0.0 && Policy::maxCostGood >= 0.0,
+		"thresholds must not be negative");
+
+private: 
+	TrackerLimits limits;
+	Storage sessions;
+	SessionTimeIndex timeIndex;
+	SessionRollups rollups;
+	DifficultyBitmapIndex difficultyIndex;
+	DescriptionIndex descriptionIndex;
+	SessionStore store;
+	QuantileSketch hoursSketch;
+	QuantileSketch costSketch;
+	TopKSessions topByHours = TopKSessions(KEY_HOURS);
+	TopKSessions topByCost = TopKSessions(KEY_COST);
+	SortedViewCache sortedViews;
+	unsigned long long version = 0; // bumped by every successful addSession
+	DerivedResults derived;
+	RuleSet rules;
+	ProjectSessionIndex projectIndex;
+	unsigned long long projectIndexVersion = 0;
+	bool projectIndexValid = false;
+	int numProjects = 0; // one past the largest project id seen
+
+	// With compile-time limits these fold to constants
+	int maxSessions() const {
+		if constexpr (Policy::runtimeLimits) {
+			if (Storage::capacity >= 0) return min(limits.maxSessions, Storage::capacity);
+			return limits.maxSessions;
+		}
+		else {
+			return Policy::maxSessions;
+		}
+	}
+
+	double minHoursGood() const {
+		if constexpr (Policy::runtimeLimits) return limits.minHoursGood;
+		else return Policy::minHoursGood;
+	}
+
+	double maxCostGood() const {
+		if constexpr (Policy::runtimeLimits) return limits.maxCostGood;
+		else return Policy::maxCostGood;
+	}
+
+	void refreshDerived() {
+		if (derived.valid && derived.version == version) return;
+
+		DashboardStats stats = computeStats();
+		derived = DerivedResults();
+		derived.valid = true;
+		derived.version = version;
+		derived.totalHours = stats.overall.hoursSum;
+		derived.totalCost = stats.overall.costSum;
+		derived.averageHours = stats.overall.meanHours();
+		derived.hardest = stats.hardest();
+	}
+
+	// Shared by the constructors, before any session is added
+	void init() {
+		difficultyIndex = DifficultyBitmapIndex(minHoursGood(), maxCostGood());
+		useDefaultRules();
+	}
+
+public:
+	int numSessions = 0;
+
+	BasicEmbroideryTracker() {
+		init();
+	}
+
+	BasicEmbroideryTracker(Session s[], int numElements) {
+		init();
+		for (int i = 0; i < numElements; ++i) {
+			addSession(s[i]);
+		}
+	}
+
+	// Only for policies with runtime limits
+	BasicEmbroideryTracker(const TrackerLimits& l) : limits(l) {
+		static_assert(Policy::runtimeLimits, "this policy fixes its limits at compile time");
+		init();
+	}
+
+	int getMaxSessions() const {
+		return maxSessions();
+	}
+
+	bool addSession(Session& s) {
+		if (numSessions >= maxSessions() || s.hours < 0 || s.cost < 0)
+			return false;
+		sessions.push(s);
+		numSessions++;
+		timeIndex.insert(s.timestamp, s.hours, s.cost);
+		rollups.add(s);
+		difficultyIndex.add(numSessions - 1, s);
+		descriptionIndex.add(numSessions - 1, s.description);
+		store.append(s);
+		hoursSketch.add(s.hours);
+		costSketch.add(s.cost);
+		topByHours.add(s);
+		topByCost.add(s);
+		sortedViews.invalidate();
+		numProjects = max(numProjects, s.projectId + 1);
+		version++;
+		return true;
+	}
+
+	int getSessionCount() {
+		return numSessions;
+	}
+
+	unsigned long long getVersion() const {
+		return version;
+	}
+
+	double calculateTotalHours() {
+		refreshDerived();
+		return derived.totalHours;
+	}
+
+	void useDefaultRules() {
+		string error;
+		rules.loadText(DEFAULT_RULES, error);
+		derived.hasRecommendation = false;
+	}
+
+	// Missing file keeps the current rules; a bad file reports an error
+	bool loadRulesFile(const string& filename, string& error) {
+		ifstream inFile(filename);
+		if (!inFile) return true;
+		if (!rules.load(inFile, error)) return false;
+		derived.hasRecommendation = false;
+		return true;
+	}
+
+	bool setRules(const string& text, string& error) {
+		if (!rules.loadText(text, error)) return false;
+		derived.hasRecommendation = false;
+		return true;
+	}
+
+	RuleContext buildRuleContext(double weeklyGoal, long long now) {
+		refreshDerived();
+		RollupBucket week = rollups.getWeek(now);
+		RollupBucket month = rollups.getMonth(now);
+
+		RuleContext ctx;
+		ctx.values[VAR_WEEK_HOURS] = week.hours;
+		ctx.values[VAR_WEEK_COST] = week.cost;
+		ctx.values[VAR_WEEK_SESSIONS] = week.count;
+		ctx.values[VAR_MONTH_HOURS] = month.hours;
+		ctx.values[VAR_MONTH_COST] = month.cost;
+		ctx.values[VAR_TOTAL_HOURS] = derived.totalHours;
+		ctx.values[VAR_TOTAL_COST] = derived.totalCost;
+		ctx.values[VAR_AVERAGE_HOURS] = derived.averageHours;
+		ctx.values[VAR_SESSIONS] = numSessions;
+		ctx.values[VAR_HARDEST] = derived.hardest;
+		ctx.values[VAR_GOAL] = weeklyGoal;
+		ctx.values[VAR_MIN_HOURS_GOOD] = minHoursGood();
+		ctx.values[VAR_MAX_COST_GOOD] = maxCostGood();
+		return ctx;
+	}
+
+	// Recommendation for the week containing 'now'
+	string getRecommendation(double weeklyGoal, long long now) {
+		refreshDerived();
+		long long week = weekKey(now);
+		long long month = monthKey(now);
+		if (derived.hasRecommendation && derived.recommendationGoal == weeklyGoal
+			&& derived.recommendationWeek == week && derived.recommendationMonth == month)
+			return derived.recommendation;
+
+		string message = rules.evaluate(buildRuleContext(weeklyGoal, now));
+
+		derived.hasRecommendation = true;
+		derived.recommendationGoal = weeklyGoal;
+		derived.recommendationWeek = week;
+		derived.recommendationMonth = month;
+		derived.recommendation = message;
+		return message;
+	}
+
+	// Range queries use from <= timestamp < to
+	double calculateHoursBetween(long long from, long long to) const {
+		return timeIndex.totalsBetween(from, to).hours;
+	}
+
+	double calculateCostBetween(long long from, long long to) const {
+		return timeIndex.totalsBetween(from, to).cost;
+	}
+
+	const SessionRollups& getRollups() const {
+		return rollups;
+	}
+
+	double getAverageHours() {
+		refreshDerived();
+		return derived.averageHours;
+	}
+
+	void fillSession() {
+
+		Session s;
+		s.description = getNonEmptyString("Session description : ");
+		s.hours = getPositiveDouble("Hours spent: ");
+		s.cost = getPositiveDouble("Thread cost: ");
+		s.difficulty = getDifficulty();
+		s.timestamp = (long long)time(nullptr);
+		addSession(s);
+	}
+
+	DifficultyLevel getHardestDifficulty() {
+		refreshDerived();
+		return derived.hardest;
+	}
+
+	const DifficultyBitmapIndex& getDifficultyIndex() const {
+		return difficultyIndex;
+	}
+
+	// Filtered aggregates over a set of rows from the difficulty index
+	double calculateHoursFor(const RoaringBitmap& rows) const {
+		double total = 0.0;
+		rows.forEach([&](unsigned int row) { total += sessions[row].hours; });
+		return total;
+	}
+
+	double calculateCostFor(const RoaringBitmap& rows) const {
+		double total = 0.0;
+		rows.forEach([&](unsigned int row) { total += sessions[row].cost; });
+		return total;
+	}
+
+	// Everything the dashboard needs in a single pass over the sessions
+	DashboardStats computeStats() const {
+		DashboardStats stats;
+		for (int i = 0; i < numSessions; i++) {
+			const Session& s = sessions[i];
+			if (s.difficulty >= EASY && s.difficulty <= HARD)
+				stats.byDifficulty[s.difficulty].add(s.hours, s.cost);
+			stats.overall.add(s.hours, s.cost);
+		}
+		return stats;
+	}
+
+	const QuantileSketch& getHoursSketch() const {
+		return hoursSketch;
+	}
+
+	const QuantileSketch& getCostSketch() const {
+		return costSketch;
+	}
+
+	const TopKSessions& getTopByHours() const {
+		return topByHours;
+	}
+
+	const TopKSessions& getTopByCost() const {
+		return topByCost;
+	}
+
+	const SessionStore& getStore() const {
+		return store;
+	}
+
+	vector<unsigned int> selectSessions(const SessionFilter& filter) const {
+		return store.select(filter);
+	}
+
+	bool runQuery(const string& text, QueryResult& result, string& error) const {
+		QueryParser parser;
+		QueryPlan plan;
+		if (!parser.parse(text, plan)) {
+			error = parser.getError();
+			return false;
+		}
+		result = QueryEngine::execute(store, plan);
+		return true;
+	}
+
+	void printQueryResult(const QueryResult& result) {
+		cout << left << setw(20) << "Group";
+		for (const string& name : result.columnNames)
+			cout << setw(15) << name;
+		cout << endl;
+
+		for (const QueryResultRow& row : result.rows) {
+			cout << left << setw(20) << (row.group.empty() ? "(all)" : row.group);
+			for (double v : row.values)
+				cout << setw(15) << fixed << setprecision(2) << v;
+			cout << endl;
+		}
+	}
+
+	const DescriptionIndex& getDescriptionIndex() const {
+		return descriptionIndex;
+	}
+
+	SessionTotals calculateTotalsFor(const vector<unsigned int>& rows) const {
+		SessionTotals totals;
+		for (unsigned int row : rows) {
+			totals.hours += sessions[row].hours;
+			totals.cost += sessions[row].cost;
+			totals.count++;
+		}
+		return totals;
+	}
+
+	// Sessions whose description contains every word of the query
+	vector<unsigned int> searchSessions(const string& query) const {
+		return descriptionIndex.matchAll(tokenize(query));
+	}
+
+	double calculateHoursFor(DifficultyLevel d) const {
+		return calculateHoursFor(difficultyIndex.rowsWith(d));
+	}
+
+	double calculateCostFor(DifficultyLevel d) const {
+		return calculateCostFor(difficultyIndex.rowsWith(d));
+	}
+	
+	void showBanner() {
+		cout << "=========================\n";
+		cout << "    Embroidery Tracker   \n";
+		cout << "=========================\n\n";
+	}
+
+	void printAllSessions() {
+		for (int i = 0; i < numSessions; i++) {
+			printSession(i);
+		}
+	}
+
+	// Row order sorted ascending by the column
+	const vector<unsigned int>& getSortedOrder(SortColumn column) {
+		return sortedViews.get(column, sessions.data(), numSessions);
+	}
+
+	void printSortedSessions(SortColumn column) {
+		printSessions(getSortedOrder(column));
+	}
+
+	// Rows of the sessions spent on a project
+	vector<unsigned int> getProjectSessions(int projectId) {
+		if (!projectIndexValid || projectIndexVersion != version) {
+			projectIndex.build(sessions.data(), numSessions, numProjects);
+			projectIndexVersion = version;
+			projectIndexValid = true;
+		}
+		return projectIndex.sessionsFor(projectId);
+	}
+
+	// Empty progress for an id the catalog does not have
+	ProjectProgress getProjectProgress(const ProjectCatalog& catalog, int projectId) {
+		ProjectProgress progress;
+		if (projectId < 0 || projectId >= catalog.size()) return progress;
+
+		SessionTotals totals = calculateTotalsFor(getProjectSessions(projectId));
+		progress.sessions = totals.count;
+		progress.actualHours = totals.hours;
+		progress.actualCost = totals.cost;
+
+		const EmbroideryItem& item = catalog.getById(projectId);
+		progress.estimatedHours = item.getDuration() / 60.0;
+		progress.estimatedCost = item.getCost();
+		return progress;
+	}
+
+	void printSessions(const vector<unsigned int>& rows) {
+		for (unsigned int row : rows) {
+			printSession((int)row);
+		}
+	}
+
+	void printSession(int sessionNum) {
+		printSessionRow(sessions[sessionNum]);
+	}
+
+	void printSessionRow(const Session& s) {
+		writeRow(cout, s, SESSION_COLUMNS);
+	}
+
+	void saveReport(string& name, double goal, const string& filename = "report.txt") {
+		ofstream outFile(filename);
+
+		outFile << "Embroidery Report for " << name << endl;
+		outFile << "Weekly Hour Goal: " << fixed << setprecision(1) << goal << "\n\n";
+
+		for (int i = 0; i < numSessions; i++) {
+			writeRow(outFile, sessions[i], SESSION_COLUMNS);
+		}
+
+		outFile << "\nSummary\n";
+		writeStats(outFile, computeStats());
+
+		outFile.close();
+	}
+
+	// Sessions file: "EMSS", u32 count, then every Session field in
+	// SESSION_RECORD order. Unlike the report, nothing is cut to a column.
+	bool saveSessions(const string& filename) const {
+		OutputBuffer out;
+		out.append("EMSS", 4);
+		encodeValue(out, (unsigned long long)numSessions, 4);
+		for (int i = 0; i < numSessions; i++)
+			encodeFields(out, sessions[i], SESSION_RECORD);
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (!file) return false;
+		bool ok = out.writeTo(file);
+		return fclose(file) == 0 && ok;
+	}
+
+	// Adds the sessions from saveSessions until the tracker is full.
+	// Returns how many were added; 'error' says why any were left out.
+	int loadSessions(const string& filename, string& error) {
+		error.clear();
+		vector<char> bytes;
+		if (!readFileBytes(filename, bytes) || bytes.size() < 8 || memcmp(bytes.data(), "EMSS", 4) != 0) {
+			error = "not a sessions file: " + filename;
+			return 0;
+		}
+		const char* p = bytes.data() + 4;
+		const char* end = bytes.data() + bytes.size();
+		unsigned long long count = 0;
+		decodeBits(p, end, 4, count);
+
+		int added = 0;
+		for (unsigned long long i = 0; i < count; i++) {
+			Session s;
+			if (!decodeFields(p, end, s, SESSION_RECORD)) {
+				error = "damaged session record " + to_string(i + 1);
+				break;
+			}
+			if (numSessions >= maxSessions()) {
+				error = "tracker is full; " + to_string(count - i) + " sessions not loaded";
+				break;
+			}
+			if (addSession(s)) added++;
+		}
+		return added;
+	}
+
+	string getNonEmptyString(string prompt) {
+		string input;
+		do {
+			cout << prompt;
+			getline(cin >> ws, input);
+		} while (input.empty());
+		return input;
+	}
+
+	double getPositiveDouble(string prompt) {
+		double value;
+		do {
+			cout << prompt;
+			cin >> value;
+
+			if (cin.fail() || value <= 0) {
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Please enter a positive number.\n";
+			}
+		} while (value <= 0);
+
+		return value;
+	}
+
+	DifficultyLevel getDifficulty() {
+		int choice;
+		cout << "Select difficulty (1 = Easy, 2 = Intermediate, 3 = Hard): ";
+		cin >> choice;
+
+		switch (choice) {
+		case EASY_VALUE: return EASY;
+		case INTERMEDIATE_VALUE: return INTERMEDIATE;
+		case HARD_VALUE: return HARD;
+		default:
+			cout << "Invalid choice. Defaulting to 'Easy'.\n";
+			return EASY;
+		}
+	}
+
+	// Returns false when the user wants entry order
+	bool getSortColumn(SortColumn& column) {
+		int choice;
+		cout << "Sort by (0 = Entry order, 1 = Hours, 2 = Cost, 3 = Difficulty, 4 = Description): ";
+		cin >> choice;
+
+		switch (choice) {
+		case 1: column = SORT_HOURS; return true;
+		case 2: column = SORT_COST; return true;
+		case 3: column = SORT_DIFFICULTY; return true;
+		case 4: column = SORT_DESCRIPTION; return true;
+		default:
+			if (cin.fail()) {
+				cin.clear();
+				cin.ignore(1000, '\n');
+			}
+			return false;
+		}
+	}
+
+	void showMenu() {
+		cout << "\nMenu:\n";
+		cout << "1. Add embroidery session.\n";
+		cout << "2. View Sessions\n";
+		cout << "3. Get recommendation\n";
+		cout << "4. Save report\n";
+		cout << "5. Search sessions\n";
+		cout << "6. Run report query\n";
+		cout << "7. View statistics\n";
+		cout << "8. View top sessions\n";
+		cout << "9. Quit\n";
+		cout << "Enter your choice: ";
+	}
+
+	// Calculation Logic (testing)
+	double calculateTotalCost() {
+		refreshDerived();
+		return derived.totalCost;
+	}
+};
+
+using EmbroideryTracker = BasicEmbroideryTracker<DefaultTrackerPolicy>;
+using StudioTracker = BasicEmbroideryTracker<StudioTrackerPolicy>;
+using FlexibleTracker = BasicEmbroideryTracker<RuntimeTrackerPolicy>;
+
+#ifdef RUN_TESTS
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+// DOCTEST
+
+TEST_CASE("Calculations - totals") {
+	Session s[2] = {
+		{"A", 2.5, 10.0, EASY},
+		{"B", 3.5, 20.0, HARD},
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 2);
+
+	CHECK(tracker.calculateTotalHours() == doctest::Approx(6.0));
+	CHECK(tracker.calculateTotalCost() == doctest::Approx(30.0));
+	CHECK(tracker.getAverageHours() == doctest::Approx(3.0));
+}
+
+TEST_CASE("Calculation edge case - no sessions") {
+	EmbroideryTracker tracker = EmbroideryTracker();
+
+	CHECK(tracker.calculateTotalHours() == 0.0);
+	CHECK(tracker.calculateTotalCost() == 0.0);
+}
+
+TEST_CASE("Calculation edge case - empty session") {
+	Session s[1] = { };
+	EmbroideryTracker tracker = EmbroideryTracker(s, 1);
+
+	CHECK(tracker.calculateTotalHours() == 0.0);
+	CHECK(tracker.calculateTotalCost() == 0.0);
+}
+
+TEST_CASE("Enum decision logic") {
+	CHECK(string(difficultyToString(EASY)) == "Easy");
+	CHECK(string(difficultyToString(INTERMEDIATE)) == "Intermediate");
+	CHECK(string(difficultyToString(HARD)) == "Hard");
+
+	Session s[2] = {
+		{"A", 2.5, 10.0, EASY},
+		{"B", 3.5, 20.0, HARD},
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 2);
+	CHECK(tracker.getHardestDifficulty() == HARD);
+}
+
+TEST_CASE("Struct and array processing") {
+	Session s[3] = {
+		{"A", 1, 5, EASY},
+		{"B", 2, 10, INTERMEDIATE},
+		{"C", 3, 15, HARD}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
+
+	CHECK(tracker.calculateTotalHours() == 6);
+	CHECK(tracker.calculateTotalCost() == 30);
+}
+
+TEST_CASE("Class methods - normal and guard cases") {
+	Session s[1] = { "Test", 2.0, 5.0, HARD };
+	EmbroideryTracker t = EmbroideryTracker(s, 1);
+	Session newSession = { "New", 3.0, 5.0, EASY };
+
+	CHECK(t.addSession(newSession) == true); // normal case
+	CHECK(t.getSessionCount() == 2);
+	CHECK(t.calculateTotalHours() == 5.0);
+	CHECK(t.getHardestDifficulty() == HARD);
+
+	Session bad = { "Bad", -1.0, -5.0, EASY };
+	CHECK(t.addSession(bad) == false);
+}
+
+// New Tests- Week 4
+TEST_CASE("EmbroideryItem constructor initializes fields") {
+	EmbroideryItem item("Sampler", 30, INTERMEDIATE);
+
+	CHECK(item.getName() == "Sampler");
+	CHECK(item.getDuration() == 30);
+	CHECK(item.getDifficulty() == INTERMEDIATE);
+}
+
+TEST_CASE("EmbroideryItem setters update fields") {
+	EmbroideryItem item;
+
+	item.setName("Updated");
+	item.setDuration(45);
+	item.setDifficulty(HARD);
+
+	CHECK(item.getName() == "Updated");
+	CHECK(item.getDuration() == 45);
+	CHECK(item.getDifficulty() == HARD);
+}
+
+TEST_CASE("CostInfo behaves correctly") {
+	CostInfo cost(0.0);
+
+	CHECK(cost.isFree() == true);
+
+	cost.setCost(12.5);
+	CHECK(cost.isFree() == false);
+	CHECK(cost.getCost() == doctest::Approx(12.5));
+}
+
+TEST_CASE("PracticeProject initializes base and derived fields") {
+	PracticeProject p("Practice", 60, EASY, 150, 20.0);
+
+	CHECK(p.getName() == "Practice");        // base
+	CHECK(p.getDuration() == 60);            // base
+	CHECK(p.getDifficulty() == EASY);        // base
+	CHECK(p.getStitchCount() == 150);         // derived
+}
+
+TEST_CASE("CommissionProject initializes base and derived fields") {
+	CommissionProject c("Logo", 90, HARD, "Client A", 75.0);
+
+	CHECK(c.getName() == "Logo");             // base
+	CHECK(c.getDuration() == 90);             // base
+	CHECK(c.getDifficulty() == HARD);         // base
+	CHECK(c.getClientName() == "Client A");   // derived
+}
+
+// New Tests- Time Index
+TEST_CASE("Time index range totals") {
+	Session s[3] = {
+		{"A", 1.0, 5.0, EASY, 100},
+		{"B", 2.0, 10.0, HARD, 200},
+		{"C", 4.0, 20.0, EASY, 300}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
+
+	CHECK(tracker.calculateHoursBetween(0, 1000) == doctest::Approx(7.0));
+	CHECK(tracker.calculateHoursBetween(150, 300) == doctest::Approx(2.0));
+	CHECK(tracker.calculateCostBetween(200, 301) == doctest::Approx(30.0));
+	CHECK(tracker.calculateHoursBetween(400, 500) == 0.0);
+}
+
+TEST_CASE("Time index handles out-of-order inserts") {
+	SessionTimeIndex index;
+	for (int i = 0; i < 1000; i++)
+		index.insert((i * 7919) % 1000, 1.0, 2.0); // every timestamp 0..999 once, shuffled
+
+	CHECK(index.size() == 1000);
+	SessionTotals totals = index.totalsBetween(100, 200);
+	CHECK(totals.count == 100);
+	CHECK(totals.hours == doctest::Approx(100.0));
+	CHECK(totals.cost == doctest::Approx(200.0));
+	CHECK(index.totalsBetween(0, 1000).count == 1000);
+}
+
+// New Tests- Rollups
+TEST_CASE("Calendar keys") {
+	CHECK(dayKey(0) == 0);
+	CHECK(dayKey(-1) == -1);
+	CHECK(weekKey(0) == weekKey(4 * SECONDS_PER_DAY - 1));  // Thu 1970-01-01 .. Sun 01-04
+	CHECK(weekKey(4 * SECONDS_PER_DAY) == weekKey(0) + 1);  // Mon 1970-01-05
+	CHECK(monthKey(0) == 1970 * 12);
+	CHECK(monthKey(31 * SECONDS_PER_DAY) == 1970 * 12 + 1);  // 1970-02-01
+	CHECK(monthKey(951782400) == 2000 * 12 + 1);             // 2000-02-29
+}
+
+TEST_CASE("Rollups update on insert") {
+	Session s[3] = {
+		{"A", 1.0, 5.0, EASY, 0},
+		{"B", 2.0, 10.0, HARD, SECONDS_PER_DAY},
+		{"C", 4.0, 20.0, HARD, 40 * SECONDS_PER_DAY}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
+	const SessionRollups& r = tracker.getRollups();
+
+	CHECK(r.getDay(0).hours == doctest::Approx(1.0));
+	CHECK(r.getWeek(0).count == 2);
+	CHECK(r.getWeek(0).cost == doctest::Approx(15.0));
+	CHECK(r.getMonth(0).difficultyCounts[HARD] == 1);
+	CHECK(r.getMonth(40 * SECONDS_PER_DAY).hours == doctest::Approx(4.0));
+	CHECK(r.monthlyTrend(0, 40 * SECONDS_PER_DAY).size() == 2);
+	CHECK(r.getWeek(100 * SECONDS_PER_DAY).count == 0);
+}
+
+// New Tests- Difficulty Index
+TEST_CASE("Roaring bitmap set operations") {
+	RoaringBitmap evens, threes;
+	for (unsigned int i = 0; i < 200000; i += 2) evens.add(i);
+	for (unsigned int i = 0; i < 200000; i += 3) threes.add(i);
+
+	CHECK(evens.cardinality() == 100000);
+	CHECK(evens.contains(131072));
+	CHECK_FALSE(evens.contains(131073));
+
+	RoaringBitmap both = evens & threes;
+	CHECK(both.cardinality() == 33334); // multiples of 6 below 200000
+	CHECK(evens.andCardinality(threes) == 33334);
+	CHECK((evens | threes).cardinality() == 100000 + 66667 - 33334);
+
+	unsigned int sum = 0;
+	RoaringBitmap small;
+	small.add(5);
+	small.add(70000);
+	small.forEach([&](unsigned int row) { sum += row; });
+	CHECK(sum == 70005);
+}
+
+TEST_CASE("Difficulty index filtered aggregates") {
+	Session s[4] = {
+		{"A", 2.0, 10.0, EASY},
+		{"B", 6.0, 60.0, HARD},
+		{"C", 3.0, 20.0, HARD},
+		{"D", 1.0, 5.0, INTERMEDIATE}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 4);
+	const DifficultyBitmapIndex& index = tracker.getDifficultyIndex();
+
+	CHECK(tracker.calculateHoursFor(HARD) == doctest::Approx(9.0));
+	CHECK(tracker.calculateCostFor(EASY) == doctest::Approx(10.0));
+	CHECK(index.rowsWith(HARD).andCardinality(index.overBudgetRows()) == 1);
+	CHECK(tracker.calculateHoursFor(index.rowsWith(HARD) & index.shortSessionRows()) == doctest::Approx(3.0));
+	CHECK(tracker.getHardestDifficulty() == HARD);
+}
+
+// New Tests- Description Index
+TEST_CASE("Posting list varint round trip") {
+	PostingList list;
+	list.add(3);
+	list.add(3); // repeat ignored
+	list.add(200);
+	list.add(100000);
+
+	vector<unsigned int> rows = list.decode();
+	CHECK(list.size() == 3);
+	CHECK(rows == vector<unsigned int>{3, 200, 100000});
+	CHECK(list.byteSize() == 1 + 2 + 3);
+}
+
+TEST_CASE("Description index term, prefix and boolean queries") {
+	Session s[4] = {
+		{"Company logo", 2.0, 10.0, EASY},
+		{"Baby blanket", 6.0, 60.0, HARD},
+		{"Logo patch, blue", 3.0, 20.0, HARD},
+		{"Blue blanket", 1.0, 5.0, INTERMEDIATE}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 4);
+	const DescriptionIndex& index = tracker.getDescriptionIndex();
+
+	CHECK(index.matchTerm("LOGO") == vector<unsigned int>{0, 2});
+	CHECK(index.matchPrefix("bl") == vector<unsigned int>{1, 2, 3});
+	CHECK(index.matchAll({ "blue", "blanket" }) == vector<unsigned int>{3});
+	CHECK(index.matchAny({ "baby", "company" }) == vector<unsigned int>{0, 1});
+	CHECK(index.matchTerm("quilt").empty());
+	CHECK(index.matchAny({ "quilt", "blue" }) == vector<unsigned int>{2, 3});
+
+	// A prefix matching many terms, each on interleaved rows
+	DescriptionIndex many;
+	for (unsigned int row = 0; row < 3000; row++)
+		many.add(row, "w" + to_string(row % 1000) + " item");
+	vector<unsigned int> all = many.matchPrefix("w");
+	CHECK(all.size() == 3000);
+	CHECK(is_sorted(all.begin(), all.end()));
+
+	SessionTotals totals = tracker.calculateTotalsFor(tracker.searchSessions("logo"));
+	CHECK(totals.count == 2);
+	CHECK(totals.hours == doctest::Approx(5.0));
+	CHECK(totals.cost == doctest::Approx(30.0));
+}
+
+// New Tests- Session Store
+TEST_CASE("Session store skips segments using zone maps") {
+	SessionStore store;
+	for (int i = 0; i < 4 * SEGMENT_SIZE; i++) {
+		Session s;
+		s.description = "S";
+		// only the third segment has expensive sessions
+		s.cost = (i / SEGMENT_SIZE == 2) ? 80.0 : 10.0;
+		s.hours = (i / SEGMENT_SIZE == 0) ? 1.0 : 6.0;
+		s.difficulty = HARD;
+		s.timestamp = i;
+		store.append(s);
+	}
+	CHECK(store.segmentCount() == 4);
+
+	vector<unsigned int> rows = store.select(SessionFilter::costAbove(MAX_COST_GOOD));
+	CHECK(rows.size() == (size_t)SEGMENT_SIZE);
+	CHECK(rows.front() == 2 * SEGMENT_SIZE);
+	CHECK(store.getScanStats().segmentsSkipped == 3);
+	CHECK(store.getScanStats().rowsScanned == 0); // the one segment left matched entirely
+
+	store.resetScanStats();
+	SessionTotals t = store.totals(SessionFilter::hoursBelow(MIN_HOURS_GOOD));
+	CHECK(t.count == SEGMENT_SIZE);
+	CHECK(t.hours == doctest::Approx(SEGMENT_SIZE * 1.0));
+	CHECK(store.getScanStats().segmentsSkipped == 3);
+
+	SessionFilter easy;
+	easy.difficultyMask = 1 << EASY;
+	CHECK(store.select(easy).empty());
+	CHECK(store.getSession(5).timestamp == 5);
+}
+
+TEST_CASE("Session store scans rows in partially matching segments") {
+	Session s[3] = {
+		{"A", 2.0, 10.0, EASY, 100},
+		{"B", 6.0, 60.0, HARD, 200},
+		{"C", 3.0, 55.0, HARD, 300}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
+
+	SessionFilter f = SessionFilter::costAbove(MAX_COST_GOOD);
+	f.maxHours = 4.0;
+	CHECK(tracker.selectSessions(f) == vector<unsigned int>{2});
+	CHECK(tracker.getStore().getScanStats().rowsScanned == 3);
+}
+
+// New Tests- Query Engine
+TEST_CASE("Query parser builds plans") {
+	QueryParser parser;
+	QueryPlan plan;
+
+	CHECK(parser.parse("WHERE difficulty=HARD AND cost>50 GROUP BY description SUM(hours)", plan));
+	REQUIRE(plan.where.size() == 2);
+	CHECK(plan.where[0].column == COL_DIFFICULTY);
+	CHECK(plan.where[0].value == HARD);
+	CHECK(plan.where[1].op == OP_GT);
+	CHECK(plan.groupBy == COL_DESCRIPTION);
+	REQUIRE(plan.aggregates.size() == 1);
+	CHECK(aggregateToString(plan.aggregates[0]) == "SUM(hours)");
+
+	CHECK_FALSE(parser.parse("WHERE color = red", plan));
+	CHECK_FALSE(parser.parse("SUM(description)", plan));
+	CHECK_FALSE(parser.parse("WHERE cost >", plan));
+	CHECK(parser.parse("WHERE difficulty = " + to_string((int)HARD), plan));
+	CHECK_FALSE(parser.parse("WHERE difficulty = -1", plan));
+	CHECK_FALSE(parser.parse("WHERE difficulty = 1e20", plan));
+	CHECK(parser.getError().find("Difficulty must be") == 0);
+	CHECK_FALSE(parser.parse("WHERE difficulty = " + to_string((int)EASY) + ".5", plan));
+	CHECK(parser.parse("WHERE timestamp < 1700000000", plan));
+	CHECK_FALSE(parser.parse("WHERE timestamp < 1.5", plan));
+	CHECK_FALSE(parser.parse("WHERE timestamp > 1e30", plan));
+	CHECK(parser.getError() == "Timestamp must be a whole number of seconds");
+}
+
+TEST_CASE("Query engine filters, groups and aggregates") {
+	SessionStore store;
+	for (int i = 0; i < 3000; i++) {
+		Session s;
+		s.description = (i % 2 == 0) ? "Logo" : "Quilt";
+		s.hours = 1.0;
+		s.cost = (i < 1500) ? 10.0 : 60.0;
+		s.difficulty = (i % 3 == 0) ? HARD : EASY;
+		store.append(s);
+	}
+
+	QueryParser parser;
+	QueryPlan plan;
+	REQUIRE(parser.parse("WHERE difficulty=HARD AND cost>50 GROUP BY description SUM(hours) COUNT(*) MAX(cost)", plan));
+	QueryResult result = QueryEngine::execute(store, plan);
+
+	// rows 1500..2999 divisible by 3: 500 rows, split evenly between even and odd
+	REQUIRE(result.rows.size() == 2);
+	CHECK(result.rows[0].group == "Logo");
+	CHECK(result.rows[0].values[0] == doctest::Approx(250.0));
+	CHECK(result.rows[1].values[1] == doctest::Approx(250.0));
+	CHECK(result.rows[1].values[2] == doctest::Approx(60.0));
+}
+
+TEST_CASE("Tracker runs ad-hoc queries") {
+	Session s[3] = {
+		{"A", 2.0, 10.0, EASY},
+		{"B", 6.0, 60.0, HARD},
+		{"C", 3.0, 55.0, HARD}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
+	QueryResult result;
+	string error;
+
+	REQUIRE(tracker.runQuery("GROUP BY difficulty AVG(cost)", result, error));
+	REQUIRE(result.rows.size() == 2);
+	CHECK(result.rows[0].group == "Easy");
+	CHECK(result.rows[1].values[0] == doctest::Approx(57.5));
+
+	REQUIRE(tracker.runQuery("WHERE description = 'B'", result, error));
+	CHECK(result.rows[0].values[0] == 1.0);
+	CHECK_FALSE(tracker.runQuery("GROUP description", result, error));
+	CHECK_FALSE(error.empty());
+}
+
+// New Tests- Dashboard Stats
+TEST_CASE("Single-pass stats by difficulty") {
+	Session s[4] = {
+		{"A", 2.0, 10.0, EASY},
+		{"B", 6.0, 60.0, HARD},
+		{"C", 3.0, 20.0, HARD},
+		{"D", 1.0, 5.0, EASY}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 4);
+	DashboardStats stats = tracker.computeStats();
+
+	CHECK(stats.overall.count == 4);
+	CHECK(stats.overall.hoursSum == doctest::Approx(tracker.calculateTotalHours()));
+	CHECK(stats.overall.costSum == doctest::Approx(tracker.calculateTotalCost()));
+	CHECK(stats.overall.meanHours() == doctest::Approx(tracker.getAverageHours()));
+	CHECK(stats.hardest() == tracker.getHardestDifficulty());
+
+	CHECK(stats.byDifficulty[HARD].count == 2);
+	CHECK(stats.byDifficulty[HARD].hoursMin == doctest::Approx(3.0));
+	CHECK(stats.byDifficulty[HARD].costMax == doctest::Approx(60.0));
+	CHECK(stats.byDifficulty[EASY].meanCost() == doctest::Approx(7.5));
+	CHECK(stats.byDifficulty[INTERMEDIATE].count == 0);
+	CHECK(stats.byDifficulty[INTERMEDIATE].meanHours() == 0.0);
+}
+
+// New Tests- Quantile Sketch
+TEST_CASE("Quantile sketch is exact while small") {
+	Session s[3] = {
+		{"A", 1.0, 10.0, EASY},
+		{"B", 12.0, 60.0, HARD},
+		{"C", 3.0, 20.0, HARD}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
+
+	CHECK(tracker.getHoursSketch().count() == 3);
+	CHECK(tracker.getHoursSketch().quantile(0.5) == 3.0);
+	CHECK(tracker.getHoursSketch().quantile(1.0) == 12.0);
+	CHECK(tracker.getCostSketch().quantile(0.0) == 10.0);
+	CHECK(QuantileSketch().quantile(0.5) == 0.0);
+}
+
+TEST_CASE("Quantile sketch stays small and merges") {
+	QuantileSketch a, b;
+	for (int i = 0; i < 100000; i++) {
+		a.add(i % 1000);
+		b.add(1000 + i % 1000);
+	}
+	CHECK(a.retained() < 2000);
+	CHECK(a.quantile(0.5) == doctest::Approx(500).epsilon(0.05));
+	CHECK(a.quantile(0.9) == doctest::Approx(900).epsilon(0.05));
+
+	a.merge(b);
+	CHECK(a.count() == 200000);
+	CHECK(a.quantile(0.5) == doctest::Approx(1000).epsilon(0.05));
+	CHECK(a.quantile(0.99) == doctest::Approx(1980).epsilon(0.05));
+}
+
+// New Tests- Top-K
+TEST_CASE("Top-K keeps the largest sessions") {
+	TopKSessions top(KEY_COST, 3);
+	for (int i = 0; i < 100; i++) {
+		Session s;
+		s.cost = (i * 37) % 100; // each cost 0..99 once
+		top.add(s);
+	}
+	vector<Session> sorted = top.getSorted();
+	REQUIRE(sorted.size() == 3);
+	CHECK(sorted[0].cost == 99);
+	CHECK(sorted[2].cost == 97);
+
+	Session s[2] = {
+		{"Short", 1.0, 90.0, EASY},
+		{"Long", 9.0, 10.0, HARD}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 2);
+	CHECK(tracker.getTopByHours().getSorted()[0].description == "Long");
+	CHECK(tracker.getTopByCost().getSorted()[0].description == "Short");
+}
+
+TEST_CASE("Top-K lists merge across users") {
+	vector<TopKSessions> lists;
+	for (int user = 0; user < 7; user++) {
+		TopKSessions top(KEY_HOURS, 4);
+		for (int i = 0; i < 50; i++) {
+			Session s;
+			s.hours = user * 50 + i;
+			top.add(s);
+		}
+		lists.push_back(top);
+	}
+	TopKSessions merged = TopKSessions::mergeAll(lists);
+	vector<Session> sorted = merged.getSorted();
+	REQUIRE(sorted.size() == 4);
+	CHECK(sorted[0].hours == 349);
+	CHECK(sorted[3].hours == 346);
+}
+
+// New Tests- Sorted Views
+TEST_CASE("Radix sort orders doubles including negatives") {
+	vector<double> values = { 3.5, -1.0, 0.0, 1e9, -250.25, 2.0, 3.5 };
+	vector<unsigned long long> keys;
+	for (double v : values)
+		keys.push_back(sortableKey(v));
+
+	vector<unsigned int> rows = radixSortRows(keys);
+	CHECK(rows == vector<unsigned int>{4, 1, 2, 5, 0, 6, 3}); // ties keep entry order
+}
+
+TEST_CASE("Sorted views are cached and refreshed on insert") {
+	Session s[3] = {
+		{"Quilt", 6.0, 10.0, HARD},
+		{"Bib", 1.0, 60.0, EASY},
+		{"Logo", 3.0, 20.0, INTERMEDIATE}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
+
+	CHECK(tracker.getSortedOrder(SORT_HOURS) == vector<unsigned int>{1, 2, 0});
+	CHECK(tracker.getSortedOrder(SORT_COST) == vector<unsigned int>{0, 2, 1});
+	CHECK(tracker.getSortedOrder(SORT_DIFFICULTY) == vector<unsigned int>{1, 2, 0});
+	CHECK(tracker.getSortedOrder(SORT_DESCRIPTION) == vector<unsigned int>{1, 2, 0});
+
+	Session quick = { "Apron", 0.5, 5.0, EASY };
+	tracker.addSession(quick);
+	CHECK(tracker.getSortedOrder(SORT_HOURS) == vector<unsigned int>{3, 1, 2, 0});
+	CHECK(tracker.getSortedOrder(SORT_DESCRIPTION).front() == 3);
+}
+
+// New Tests- Derived Results Cache
+TEST_CASE("Recommendation follows the weekly totals") {
+	Session s[2] = {
+		{"A", 3.0, 10.0, EASY, 0},
+		{"B", 4.0, 20.0, HARD, SECONDS_PER_DAY}
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 2);
+
+	CHECK(tracker.getRecommendation(5.0, 0) == "Great job! You met your weekly goal AND stayed on budget.");
+	CHECK(tracker.getRecommendation(10.0, 0) == "You are making steady progress. Keep going!");
+
+	Session pricey = { "C", 1.0, 40.0, EASY, 2 * SECONDS_PER_DAY };
+	tracker.addSession(pricey);
+	CHECK(tracker.getRecommendation(10.0, 0) == "You may want shorter sessions or lower-cost projects.");
+	CHECK(tracker.getRecommendation(10.0, 30 * SECONDS_PER_DAY) == "You are making steady progress. Keep going!");
+}
+
+TEST_CASE("Derived results refresh when the version changes") {
+	EmbroideryTracker tracker;
+	CHECK(tracker.getVersion() == 0);
+	CHECK(tracker.getAverageHours() == 0.0);
+
+	Session a = { "A", 2.0, 5.0, INTERMEDIATE };
+	tracker.addSession(a);
+	CHECK(tracker.getVersion() == 1);
+	CHECK(tracker.calculateTotalHours() == doctest::Approx(2.0));
+	CHECK(tracker.getHardestDifficulty() == INTERMEDIATE);
+
+	Session bad = { "Bad", -1.0, 5.0, EASY };
+	tracker.addSession(bad);
+	CHECK(tracker.getVersion() == 1); // rejected sessions don't bump the version
+
+	Session b = { "B", 4.0, 7.0, HARD };
+	tracker.addSession(b);
+	CHECK(tracker.getAverageHours() == doctest::Approx(3.0));
+	CHECK(tracker.calculateTotalCost() == doctest::Approx(12.0));
+	CHECK(tracker.getHardestDifficulty() == HARD);
+}
+
+// New Tests- Rule Engine
+TEST_CASE("Rule engine compiles and evaluates expressions") {
+	RuleSet rules;
+	string error;
+	REQUIRE(rules.loadText(
+		"# comment\n"
+		"\n"
+		"if not (weekHours + 1 > goal * 2) and hardest == hard then Push harder\n"
+		"if sessions >= 2 or averageHours < minHoursGood then Keep it up\n", error));
+	CHECK(rules.size() == 2);
+
+	RuleContext ctx;
+	ctx.values[VAR_WEEK_HOURS] = 3.0;
+	ctx.values[VAR_GOAL] = 2.0;
+	ctx.values[VAR_HARDEST] = HARD;
+	CHECK(rules.evaluate(ctx) == "Push harder");
+
+	ctx.values[VAR_WEEK_HOURS] = 4.0;
+	ctx.values[VAR_AVERAGE_HOURS] = 1.0;
+	ctx.values[VAR_MIN_HOURS_GOOD] = MIN_HOURS_GOOD;
+	CHECK(rules.evaluate(ctx) == "Keep it up");
+
+	ctx.values[VAR_AVERAGE_HOURS] = 9.0;
+	CHECK(rules.evaluate(ctx) == "");
+}
+
+TEST_CASE("Rule engine reports errors and keeps old rules") {
+	RuleSet rules;
+	string error;
+	REQUIRE(rules.loadText("if true then Fine\n", error));
+
+	CHECK_FALSE(rules.loadText("if colour > 2 then Nope\n", error));
+	CHECK(error == "line 1: unknown name 'colour'");
+	CHECK_FALSE(rules.loadText("if true then A\nwhen true then B\n", error));
+	CHECK(error == "line 2: rules must start with 'if'");
+	CHECK_FALSE(rules.loadText("if (goal > 1 then C\n", error));
+	CHECK_FALSE(rules.loadText("if goal > 1 then\n", error));
+
+	CHECK(rules.evaluate(RuleContext()) == "Fine");
+}
+
+TEST_CASE("Tracker recommendation uses custom rules") {
+	Session s[1] = { {"A", 6.0, 10.0, EASY, 0} };
+	EmbroideryTracker tracker = EmbroideryTracker(s, 1);
+	string error;
+
+	CHECK(tracker.getRecommendation(5.0, 0) == "Great job! You met your weekly goal AND stayed on budget.");
+	REQUIRE(tracker.setRules("if weekHours >= minHoursGood then Long week!\nif true then Short week.\n", error));
+	CHECK(tracker.getRecommendation(5.0, 0) == "Long week!");
+	CHECK(tracker.getRecommendation(5.0, 30 * SECONDS_PER_DAY) == "Short week.");
+
+	// 2024-01-31 and 2024-02-01 share a week but not a month
+	const long long JAN_31 = 1706659200LL, FEB_1 = JAN_31 + SECONDS_PER_DAY;
+	Session late[1] = { {"B", 1.0, 5.0, EASY, JAN_31} };
+	EmbroideryTracker monthly = EmbroideryTracker(late, 1);
+	REQUIRE(monthly.setRules("if monthHours > 0 then Active month\nif true then Quiet month\n", error));
+	CHECK(weekKey(JAN_31) == weekKey(FEB_1));
+	CHECK(monthly.getRecommendation(5.0, JAN_31) == "Active month");
+	CHECK(monthly.getRecommendation(5.0, FEB_1) == "Quiet month");
+}
+
+// New Tests- Tracker Policies
+TEST_CASE("Default policy keeps the original limits") {
+	EmbroideryTracker tracker;
+	CHECK(tracker.getMaxSessions() == MAX_SESSIONS);
+
+	Session s = { "A", 1.0, 60.0, EASY };
+	for (int i = 0; i < MAX_SESSIONS; i++)
+		CHECK(tracker.addSession(s));
+	CHECK_FALSE(tracker.addSession(s));
+	CHECK(tracker.getDifficultyIndex().overBudgetRows().cardinality() == MAX_SESSIONS);
+}
+
+TEST_CASE("Studio policy uses its own thresholds") {
+	StudioTracker tracker;
+	CHECK(tracker.getMaxSessions() == 500);
+
+	Session s = { "A", 8.0, 60.0, EASY };
+	for (int i = 0; i < 100; i++)
+		tracker.addSession(s);
+	CHECK(tracker.getSessionCount() == 100);
+	CHECK(tracker.getDifficultyIndex().overBudgetRows().isEmpty()); // 60 is under 200
+	CHECK(tracker.getDifficultyIndex().shortSessionRows().cardinality() == 100); // 8 is under 10
+	CHECK(tracker.calculateTotalCost() == doctest::Approx(6000.0));
+}
+
+TEST_CASE("Runtime policy reads limits at run time") {
+	TrackerLimits limits;
+	limits.maxSessions = 1000;
+	limits.maxCostGood = 20.0;
+	FlexibleTracker tracker(limits);
+	CHECK(tracker.getMaxSessions() == 1000);
+
+	Session s = { "A", 1.0, 25.0, EASY, 0 };
+	for (int i = 0; i < 1000; i++)
+		tracker.addSession(s);
+	CHECK(tracker.getSessionCount() == 1000);
+	CHECK_FALSE(tracker.addSession(s));
+	CHECK(tracker.getDifficultyIndex().overBudgetRows().cardinality() == 1000);
+	CHECK(tracker.getRecommendation(2000.0, 0) == "You may want shorter sessions or lower-cost projects.");
+}
+
+// New Tests- Project Catalog
+TEST_CASE("Projects report their cost through the base class") {
+	PracticeProject p("Practice", 60, EASY, 150, 20.0);
+	CommissionProject c("Logo", 90, HARD, "Client A", 75.0);
+	EmbroideryItem plain("Sampler", 30, INTERMEDIATE);
+	const EmbroideryItem& base = c;
+
+	CHECK(p.getCost() == doctest::Approx(20.0));
+	CHECK(p.getCostInfo().isFree() == false);
+	CHECK(base.getCost() == doctest::Approx(75.0));
+	CHECK(plain.getCost() == 0.0);
+}
+
+TEST_CASE("Project catalog stores projects by type") {
+	ProjectCatalog catalog;
+	catalog.add(PracticeProject("Practice", 60, EASY, 150, 20.0));
+	catalog.add(CommissionProject("Logo", 90, HARD, "Client A", 75.0));
+	catalog.add(PracticeProject("Border", 45, INTERMEDIATE, 900, 5.0));
+
+	CHECK(catalog.size() == 3);
+	CHECK(catalog.getPracticeProjects().size() == 2);
+	CHECK(catalog.getCommissionProjects()[0].getClientName() == "Client A");
+	CHECK(catalog.totalCost() == doctest::Approx(100.0));
+	CHECK(catalog.totalDuration() == 195);
+
+	int stitches = 0;
+	catalog.forEach([&](const auto& item) {
+		if constexpr (is_same<decltype(item), const PracticeProject&>::value)
+			stitches += item.getStitchCount();
+	});
+	CHECK(stitches == 1050);
+}
+
+TEST_CASE("Project catalog indexes and per-type totals") {
+	ProjectCatalog catalog;
+	catalog.add(PracticeProject("Sampler", 60, EASY, 150, 20.0));
+	catalog.add(CommissionProject("Logo", 90, HARD, "Client A", 75.0));
+	catalog.add(CommissionProject("Patch", 30, HARD, "Client B", 25.0));
+	catalog.add(PracticeProject("Logo", 45, HARD, 900, 5.0));
+	catalog.add(CommissionProject("Banner", 120, EASY, "Client A", 150.0));
+
+	CatalogTotals totals = catalog.computeTotals();
+	CHECK(totals.practice.count == 2);
+	CHECK(totals.practice.stitches == 1050);
+	CHECK(totals.commission.cost == doctest::Approx(250.0));
+	CHECK(totals.commission.duration == 240);
+	CHECK(totals.overall().cost == doctest::Approx(catalog.totalCost()));
+
+	CHECK(catalog.withName("Logo").size() == 2);
+	CHECK(catalog.get(catalog.withName("Logo")[1]).getDuration() == 45);
+	CHECK(catalog.forClient("Client A") == vector<int>{0, 2});
+	CHECK(catalog.forClient("Nobody").empty());
+
+	CatalogTotals hard = catalog.computeTotals(catalog.withDifficulty(HARD));
+	CHECK(hard.overall().count == 3);
+	CHECK(hard.overall().cost == doctest::Approx(105.0));
+	CHECK(catalog.withDifficulty(INTERMEDIATE).empty());
+}
+
+TEST_CASE("Client registry interns names") {
+	ClientRegistry registry;
+	CHECK(registry.intern("Client A") == 0);
+	CHECK(registry.intern("Client B") == 1);
+	CHECK(registry.intern("Client A") == 0);
+	CHECK(registry.find("Client B") == 1);
+	CHECK(registry.find("Client C") == -1);
+	CHECK(registry.getName(1) == "Client B");
+}
+
+TEST_CASE("Billing engine totals every client") {
+	ProjectCatalog catalog;
+	const string names[3] = { "Ann", "Bo", "Cy" };
+	for (int i = 0; i < 30000; i++)
+		catalog.add(CommissionProject("Job", 10, EASY, names[i % 3], 2.0 + i % 3));
+	catalog.add(PracticeProject("Practice", 60, EASY, 150, 20.0)); // not billed
+
+	vector<Invoice> invoices = BillingEngine::billAll(catalog, 4);
+	REQUIRE(invoices.size() == 3);
+	CHECK(invoices[0].clientName == "Ann");
+	CHECK(invoices[0].projects == 10000);
+	CHECK(invoices[1].cost == doctest::Approx(30000.0));
+	CHECK(invoices[2].duration == 100000);
+
+	vector<Invoice> single = BillingEngine::billAll(catalog, 1);
+	CHECK(single[2].cost == doctest::Approx(invoices[2].cost));
+
+	ostringstream out;
+	BillingEngine::writeInvoices(out, invoices);
+	CHECK(out.str().find("$40000.00") != string::npos);
+}
+
+// New Tests- Project Sessions
+TEST_CASE("CSR index groups sessions by project") {
+	Session s[5] = {
+		{"A", 1.0, 5.0, EASY, 0, 2},
+		{"B", 2.0, 10.0, EASY, 0, 0},
+		{"C", 3.0, 15.0, EASY, 0, -1},
+		{"D", 4.0, 20.0, EASY, 0, 2},
+		{"E", 5.0, 25.0, EASY, 0, 9} // unknown project
+	};
+	ProjectSessionIndex index;
+	index.build(s, 5, 3);
+
+	CHECK(index.projectCount() == 3);
+	CHECK(index.sessionsFor(2) == vector<unsigned int>{0, 3});
+	CHECK(index.sessionsFor(0) == vector<unsigned int>{1});
+	CHECK(index.sessionsFor(1).empty());
+	CHECK(index.sessionsFor(7).empty());
+}
+
+TEST_CASE("Project progress compares sessions with estimates") {
+	ProjectCatalog catalog;
+	int practice = catalog.add(PracticeProject("Practice", 120, EASY, 150, 20.0));
+	int logo = catalog.add(CommissionProject("Logo", 90, HARD, "Client A", 75.0));
+	CHECK(catalog.getRef(logo).type == COMMISSION_PROJECT);
 
-TEST_CASE("Struct and array processing") {
 	Session s[3] = {
-		{"A", 1, 5, EASY},
-		{"B", 2, 10, INTERMEDIATE},
-		{"C", 3, 15, HARD}
+		{"Outline", 1.0, 5.0, EASY, 0, logo},
+		{"Fill", 1.5, 12.0, HARD, 0, logo},
+		{"Warmup", 0.5, 2.0, EASY, 0, practice}
 	};
 	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
 
-	CHECK(tracker.calculateTotalHours() == 6);
-	CHECK(tracker.calculateTotalCost() == 30);
+	ProjectProgress progress = tracker.getProjectProgress(catalog, logo);
+	CHECK(progress.sessions == 2);
+	CHECK(progress.actualHours == doctest::Approx(2.5));
+	CHECK(progress.actualCost == doctest::Approx(17.0));
+	CHECK(progress.estimatedHours == doctest::Approx(1.5));
+	CHECK(progress.estimatedCost == doctest::Approx(75.0));
+
+	Session more = { "Touch up", 0.5, 1.0, EASY, 0, practice };
+	tracker.addSession(more);
+	CHECK(tracker.getProjectProgress(catalog, practice).actualHours == doctest::Approx(1.0));
+	CHECK(tracker.getProjectProgress(catalog, -1).sessions == 0);
+	CHECK(tracker.getProjectProgress(catalog, catalog.size()).estimatedCost == 0.0);
 }
 
-TEST_CASE("Class methods - normal and guard cases") {
-	Session s[1] = { "Test", 2.0, 5.0, HARD };
-	EmbroideryTracker t = EmbroideryTracker(s, 1);
-	Session newSession = { "New", 3.0, 5.0, EASY };
+// New Tests- Output Buffer
+TEST_CASE("Output buffer formats numbers like iostreams") {
+	OutputBuffer out;
+	out.appendInt(0).append(' ').appendInt(-120).append(' ').appendInt(9876543210LL)
+		.append(' ').appendFixed(2.005, 1).append(' ').appendFixed(75.0, 2);
 
-	CHECK(t.addSession(newSession) == true); // normal case
-	CHECK(t.getSessionCount() == 2);
-	CHECK(t.calculateTotalHours() == 5.0);
-	CHECK(t.getHardestDifficulty() == HARD);
+	ostringstream expected;
+	expected << 0 << ' ' << -120 << ' ' << 9876543210LL << ' '
+		<< fixed << setprecision(1) << 2.005 << ' ' << setprecision(2) << 75.0;
+	CHECK(out.str() == expected.str());
 
-	Session bad = { "Bad", -1.0, -5.0, EASY };
-	CHECK(t.addSession(bad) == false);
+	string sent;
+	CHECK(out.writeWith([&](const char* data, size_t length) {
+		size_t n = min(length, (size_t)4); // sink that takes a few bytes at a time
+		sent.append(data, n);
+		return (long long)n;
+	}));
+	CHECK(sent == out.str());
 }
 
-// New Tests- Week 4
-TEST_CASE("EmbroideryItem constructor initializes fields") {
+TEST_CASE("Items format into a buffer") {
+	PracticeProject p("Practice", 60, EASY, 150, 20.0);
+	CommissionProject c("Logo", 90, HARD, "Client A", 75.0);
 	EmbroideryItem item("Sampler", 30, INTERMEDIATE);
 
-	CHECK(item.getName() == "Sampler");
-	CHECK(item.getDuration() == 30);
-	CHECK(item.getDifficulty() == INTERMEDIATE);
+	OutputBuffer out;
+	item.format(out);
+	CHECK(out.str() == "Name: Sampler, Duration: 30, Difficulty: Intermediate");
+
+	out.clear();
+	const EmbroideryItem& base = c;
+	base.format(out);
+	CHECK(out.str() == "Name: Logo, Duration: 90, Difficulty: Hard, Client: Client A, Cost: $75.00\n");
+
+	ProjectCatalog catalog;
+	catalog.add(p);
+	catalog.add(c);
+	out.clear();
+	catalog.writeListing(out);
+	CHECK(out.str() == "Name: Practice, Duration: 60, Difficulty: Easy, Stitches: 150, Cost: $20.00\n"
+		"Name: Logo, Duration: 90, Difficulty: Hard, Client: Client A, Cost: $75.00\n");
 }
 
-TEST_CASE("EmbroideryItem setters update fields") {
-	EmbroideryItem item;
+// New Tests- Binary Catalog
+TEST_CASE("Binary catalog round trip") {
+	ProjectCatalog catalog;
+	catalog.add(PracticeProject("Practice", 60, EASY, 150, 20.0));
+	catalog.add(CommissionProject("Logo", 90, HARD, "Client A", 75.5));
 
-	item.setName("Updated");
-	item.setDuration(45);
-	item.setDifficulty(HARD);
+	OutputBuffer out;
+	CatalogWriter writer(out);
+	writer.write(catalog);
+	writer.write(EmbroideryItem("Sampler", 30, INTERMEDIATE));
 
-	CHECK(item.getName() == "Updated");
-	CHECK(item.getDuration() == 45);
-	CHECK(item.getDifficulty() == HARD);
+	CatalogReader reader(out.data(), out.size());
+	string error;
+	REQUIRE(reader.open(error));
+	CHECK(reader.getRecordCount() == 3);
+	CHECK(reader.getVersion() == CATALOG_SCHEMA_VERSION);
+
+	ProjectView view;
+	REQUIRE(reader.next(view, error));
+	CHECK(view.type == RECORD_PRACTICE);
+	CHECK(view.name == "Practice");
+	CHECK(view.stitchCount == 150);
+	REQUIRE(reader.next(view, error));
+	CHECK(view.clientName == "Client A");
+	CHECK(view.clientName.data() >= out.data()); // points into the buffer
+	CHECK(view.cost == 75.5);
+	REQUIRE(reader.next(view, error));
+	CHECK(view.type == RECORD_ITEM);
+	CHECK(view.difficulty == INTERMEDIATE);
+	CHECK_FALSE(reader.next(view, error));
+	CHECK(error.empty());
+
+	ProjectCatalog loaded;
+	CatalogReader again(out.data(), out.size());
+	REQUIRE(again.open(error));
+	REQUIRE(again.readInto(loaded, error));
+	CHECK(loaded.size() == 2);
+	CHECK(loaded.computeTotals().overall().cost == doctest::Approx(95.5));
+
+	ProjectCatalog fromFile;
+	REQUIRE(saveCatalog(catalog, "test_catalog.bin"));
+	CHECK(loadCatalog("test_catalog.bin", fromFile, error));
+	CHECK(fromFile.forClient("Client A").size() == 1);
+	remove("test_catalog.bin");
 }
 
-TEST_CASE("CostInfo behaves correctly") {
-	CostInfo cost(0.0);
+TEST_CASE("Binary catalog skips unknown fields and records") {
+	// version 2 file: practice record with an extra field 99, then an unknown record type 9
+	const unsigned char bytes[] = {
+		'E', 'M', 'B', 'R', 2, 0, 0, 0, 2, 0, 0, 0,
+		RECORD_PRACTICE, 24, 0, 0, 0,
+		FIELD_NAME, 2, 0, 0, 0, 'H', 'i',
+		99, 3, 0, 0, 0, 1, 2, 3,
+		FIELD_STITCH_COUNT, 4, 0, 0, 0, 0x10, 0x27, 0, 0,
+		9, 2, 0, 0, 0, 7, 7
+	};
+	CatalogReader reader((const char*)bytes, sizeof(bytes));
+	string error;
+	REQUIRE(reader.open(error));
 
-	CHECK(cost.isFree() == true);
+	ProjectView view;
+	REQUIRE(reader.next(view, error));
+	CHECK(view.name == "Hi");
+	CHECK(view.stitchCount == 10000);
+	CHECK_FALSE(reader.next(view, error));
+	CHECK(error.empty());
 
-	cost.setCost(12.5);
-	CHECK(cost.isFree() == false);
-	CHECK(cost.getCost() == doctest::Approx(12.5));
+	CatalogReader truncated((const char*)bytes, 20);
+	REQUIRE(truncated.open(error));
+	CHECK_FALSE(truncated.next(view, error));
+	CHECK(error == "truncated record");
+
+	CatalogReader bad("JUNKJUNKJUNK", 12);
+	CHECK_FALSE(bad.open(error));
 }
 
-TEST_CASE("PracticeProject initializes base and derived fields") {
-	PracticeProject p("Practice", 60, EASY, 150, 20.0);
+TEST_CASE("Binary catalog skips records with a bad difficulty") {
+	ProjectCatalog catalog;
+	catalog.add(PracticeProject("Practice", 60, EASY, 150, 20.0));
+	catalog.add(CommissionProject("Logo", 90, HARD, "Client A", 75.5));
+	OutputBuffer out;
+	CatalogWriter writer(out);
+	writer.write(catalog);
 
-	CHECK(p.getName() == "Practice");        // base
-	CHECK(p.getDuration() == 60);            // base
-	CHECK(p.getDifficulty() == EASY);        // base
-	CHECK(p.getStitchCount() == 150);         // derived
+	// Corrupt the first record's difficulty byte
+	string bytes = out.str();
+	const char field[] = { (char)FIELD_DIFFICULTY, 1, 0, 0, 0 };
+	size_t at = bytes.find(string(field, 5));
+	REQUIRE(at != string::npos);
+	bytes[at + 5] = 9;
+
+	CatalogReader reader(bytes.data(), bytes.size());
+	string error;
+	REQUIRE(reader.open(error));
+	ProjectCatalog loaded;
+	CHECK_FALSE(reader.readInto(loaded, error));
+	CHECK(error == "1 damaged record(s) skipped");
+	CHECK(reader.getDamagedRecords() == 1);
+	REQUIRE(loaded.size() == 1);
+	CHECK(loaded.getCommissionProjects()[0].getDifficulty() == HARD);
+
+	Session s;
+	OutputBuffer record;
+	encodeFields(record, Session{ "A", 1.0, 2.0, HARD }, SESSION_RECORD);
+	string damaged = record.str();
+	damaged[4 + 1 + 8 + 8] = 7; // difficulty follows description, hours and cost
+	const char* p = damaged.data();
+	CHECK_FALSE(decodeFields(p, damaged.data() + damaged.size(), s, SESSION_RECORD));
 }
 
-TEST_CASE("CommissionProject initializes base and derived fields") {
+// New Tests- Field Descriptors
+TEST_CASE("Session columns format and parse consistently") {
+	Session s = { "Baby blanket", 2.5, 12.0, INTERMEDIATE };
+
+	ostringstream header, row;
+	writeHeader(header, SESSION_COLUMNS);
+	writeRow(row, s, SESSION_COLUMNS);
+	CHECK(header.str() == "Description         Hours     Cost      Difficulty     \n");
+	CHECK(row.str() == "Baby blanket        2.5       12.00     Intermediate   \n");
+
+	Session parsed;
+	string line = row.str();
+	CHECK(parseRow(line.substr(0, line.size() - 1), parsed, SESSION_COLUMNS));
+	CHECK(parsed.description == "Baby blanket");
+	CHECK(parsed.hours == 2.5);
+	CHECK(parsed.cost == 12.0);
+	CHECK(parsed.difficulty == INTERMEDIATE);
+
+	CHECK_FALSE(parseRow("Logo                abc       1.00      Easy", parsed, SESSION_COLUMNS));
+	CHECK_FALSE(parseRow("Logo                1.0       1.00      Expert", parsed, SESSION_COLUMNS));
+
+	int small = 7;
+	long long wide = 0;
+	CHECK(parseValue("-2147483648", small));
+	CHECK_FALSE(parseValue("3000000000", small));
+	CHECK(small == INT_MIN);
+	CHECK_FALSE(parseValue("99999999999999999999", wide));
+}
+
+TEST_CASE("Sessions file keeps every field") {
+	Session s[3] = {
+		{ "Baby blanket with a long name", 2.5, 12.0, INTERMEDIATE, 1700000000LL, 3 },
+		{ "Logo", 1.0, 60.0, HARD },
+		{ "Hat", 0.5, 4.0, EASY }
+	};
+	EmbroideryTracker tracker = EmbroideryTracker(s, 3);
+	string filename = (filesystem::temp_directory_path() / "embroidery_sessions_test.bin").string();
+	REQUIRE(tracker.saveSessions(filename));
+
+	EmbroideryTracker loaded;
+	string error;
+	CHECK(loaded.loadSessions(filename, error) == 3);
+	CHECK(error.empty());
+	CHECK(loaded.getSessionCount() == 3);
+	CHECK(loaded.calculateTotalCost() == doctest::Approx(76.0));
+	CHECK(loaded.getDescriptionIndex().matchTerm("long") == vector<unsigned int>{0});
+	CHECK(loaded.calculateHoursBetween(1700000000LL, 1700000001LL) == doctest::Approx(2.5));
+	CHECK(loaded.getProjectSessions(3) == vector<unsigned int>{0});
+
+	// Only two more fit under the default limit of five
+	CHECK(loaded.loadSessions(filename, error) == MAX_SESSIONS - 3);
+	CHECK(error == "tracker is full; 1 sessions not loaded");
+	CHECK(loaded.getSessionCount() == MAX_SESSIONS);
+
+	CHECK(loaded.loadSessions(filename + ".missing", error) == 0);
+	CHECK_FALSE(error.empty());
+	remove(filename.c_str());
+}
+
+TEST_CASE("Session binary codec round trip") {
+	Session s = { "Logo", 1.5, 7.25, HARD, 1700000000LL, 42 };
+	OutputBuffer out;
+	encodeFields(out, s, SESSION_RECORD);
+	CHECK(out.size() == 4 + 4 + 8 + 8 + 1 + 8 + 4);
+
+	Session back;
+	const char* p = out.data();
+	REQUIRE(decodeFields(p, out.data() + out.size(), back, SESSION_RECORD));
+	CHECK(p == out.data() + out.size());
+	CHECK(back.description == "Logo");
+	CHECK(back.cost == 7.25);
+	CHECK(back.difficulty == HARD);
+	CHECK(back.timestamp == 1700000000LL);
+	CHECK(back.projectId == 42);
+
+	p = out.data();
+	CHECK_FALSE(decodeFields(p, out.data() + 10, back, SESSION_RECORD));
+}
+
+TEST_CASE("Item descriptors drive labeled output") {
 	CommissionProject c("Logo", 90, HARD, "Client A", 75.0);
+	OutputBuffer out;
+	formatLabeled(out, c, CommissionProject::fields());
+	CHECK(out.str() == "Name: Logo, Duration: 90, Difficulty: Hard, Client: Client A, Cost: $75.00");
 
-	CHECK(c.getName() == "Logo");             // base
-	CHECK(c.getDuration() == 90);             // base
-	CHECK(c.getDifficulty() == HARD);         // base
-	CHECK(c.getClientName() == "Client A");   // derived
+	ostringstream row;
+	writeRow(row, c, CommissionProject::fields());
+	CHECK(row.str().find("Client A") == 45);
+	CHECK(tuple_size<decltype(PracticeProject::fields())>::value == 5);
+}
+
+// New Tests- Pattern Files
+// DST file built in memory: spaces for the header, then records
+string dstBytes(const vector<vector<unsigned char>>& records) {
+	string bytes(DST_HEADER_SIZE, ' ');
+	for (const auto& r : records) bytes.append((const char*)r.data(), r.size());
+	return bytes;
+}
+
+TEST_CASE("DST records decode into stitches, jumps and colors") {
+	string bytes = dstBytes({
+		{ 0x81, 0x00, 0x03 },  // stitch +1, +1
+		{ 0x00, 0x04, 0x03 },  // stitch x +27
+		{ 0x00, 0x00, 0x87 },  // jump x +81
+		{ 0x00, 0x00, 0xC3 },  // color change
+		{ 0x42, 0x00, 0x03 },  // stitch -1, -1
+		{ 0x00, 0x00, 0xF3 },  // end
+		{ 0x01, 0x00, 0x03 },  // ignored after the end
+	});
+
+	StitchPattern pattern;
+	PatternParser parser(PATTERN_DST, &pattern);
+	parser.feed(bytes.data(), bytes.size());
+	string error;
+	REQUIRE(parser.finish(error));
+
+	const PatternStats& stats = parser.stats();
+	CHECK(stats.stitches == 3);
+	CHECK(stats.jumps == 1);
+	CHECK(stats.colorChanges == 1);
+	CHECK(stats.colors() == 2);
+	CHECK(stats.ended);
+	CHECK(stats.minX == 1);
+	CHECK(stats.maxX == 108);
+	CHECK(stats.width() == 107);
+	CHECK(stats.height() == 1);
+	REQUIRE(pattern.size() == 6);
+	CHECK(pattern.xs[4] == 108);
+	CHECK(pattern.types[3] == STITCH_COLOR);
+
+	// Same result when every byte arrives in its own chunk
+	PatternParser bytewise(PATTERN_DST);
+	for (char c : bytes) bytewise.feed(&c, 1);
+	CHECK(bytewise.finish(error));
+	CHECK(bytewise.stats().stitches == 3);
+	CHECK(bytewise.stats().maxX == 108);
+
+	PatternParser truncated(PATTERN_DST);
+	truncated.feed(bytes.data(), DST_HEADER_SIZE + 4);
+	CHECK_FALSE(truncated.finish(error));
+}
+
+TEST_CASE("Text patterns populate a practice project") {
+	string text =
+		"# test design\n"
+		"0 0 STITCH\n"
+		"40 10 STITCH\n"
+		"\n"
+		"100 50 JUMP\n"
+		"100 50 COLOR\n"
+		"120 -20 STITCH\n"
+		"120 -20 END";
+	PatternParser parser(PATTERN_TEXT);
+	parser.feed(text.data(), 20);
+	parser.feed(text.data() + 20, text.size() - 20);
+	string error;
+	REQUIRE(parser.finish(error));
+	CHECK(parser.stats().stitches == 3);
+	CHECK(parser.stats().jumps == 1);
+	CHECK(parser.stats().width() == 120);
+	CHECK(parser.stats().height() == 30);
+	CHECK(parser.stats().ended);
+
+	PracticeProject project("Sampler", 60, EASY, 0, 10.0);
+	applyPattern(project, parser.stats());
+	CHECK(project.getStitchCount() == 3);
+
+	PatternParser bad(PATTERN_TEXT);
+	string badText = "0 0 STITCH\n5 5 KNOT\n";
+	bad.feed(badText.data(), badText.size());
+	CHECK_FALSE(bad.finish(error));
+	CHECK(error == "line 2: unknown record type KNOT");
+
+	PatternFormat format;
+	CHECK(patternFormatFromName("rose.DST", format));
+	CHECK(format == PATTERN_DST);
+	CHECK_FALSE(patternFormatFromName("rose.pes", format));
+}
+
+// New Tests- Library Analyzer
+void writeTextFile(const filesystem::path& path, const string& text) {
+	ofstream out(path, ios::binary);
+	out << text;
+}
+
+TEST_CASE("Work stealing runs every task once") {
+	vector<int> runs(1000, 0);
+	runWorkStealing(runs.size(), 4, [&](size_t i) { runs[i]++; });
+	CHECK(count(runs.begin(), runs.end(), 1) == 1000);
+}
+
+TEST_CASE("Library analyzer caches results between runs") {
+	filesystem::path dir = filesystem::temp_directory_path() / "embroidery_library_test";
+	filesystem::remove_all(dir);
+	filesystem::create_directories(dir / "flowers");
+	writeTextFile(dir / "heart.txt", "0 0 STITCH\n10 10 STITCH\n10 10 END\n");
+	writeTextFile(dir / "flowers" / "rose.txt", "0 0 STITCH\n0 0 COLOR\n5 0 STITCH\n5 20 STITCH\n");
+	writeTextFile(dir / "flowers" / "broken.txt", "0 0 KNOT\n");
+	writeTextFile(dir / "notes.md", "not a pattern");
+	string dst(DST_HEADER_SIZE, ' ');
+	dst += string("\x81\x00\x03\x00\x00\xF3", 6);
+	writeTextFile(dir / "logo.dst", dst);
+
+	PatternCache cache;
+	LibraryScan first = LibraryAnalyzer::analyze(dir.string(), cache, 3);
+	CHECK(first.entries.size() == 4);
+	CHECK(first.parsed == 3);
+	CHECK(first.cached == 0);
+	CHECK(first.failed == 1);
+	CHECK(cache.size() == 3);
+
+	string cacheFile = (dir / "cache.bin").string();
+	REQUIRE(cache.save(cacheFile));
+	PatternCache reloaded;
+	REQUIRE(reloaded.load(cacheFile));
+	const PatternCacheEntry* rose = reloaded.find((dir / "flowers" / "rose.txt").string());
+	REQUIRE(rose != nullptr);
+	CHECK(rose->stats.stitches == 3);
+	CHECK(rose->stats.height() == 20);
+
+	LibraryScan second = LibraryAnalyzer::analyze(dir.string(), reloaded, 3);
+	CHECK(second.parsed == 0);
+	CHECK(second.cached == 3);
+
+	writeTextFile(dir / "heart.txt", "0 0 STITCH\n10 10 STITCH\n20 0 STITCH\n");
+	LibraryScan third = LibraryAnalyzer::analyze(dir.string(), reloaded, 3);
+	CHECK(third.parsed == 1);
+	CHECK(third.cached == 2);
+
+	ProjectCatalog catalog;
+	LibraryAnalyzer::addToCatalog(third, catalog);
+	CHECK(catalog.getPracticeProjects().size() == 3);
+	CHECK(catalog.computeTotals().practice.stitches == 3 + 3 + 1);
+
+	filesystem::remove_all(dir);
+}
+
+// New Tests- Machine Estimates
+TEST_CASE("Machine estimate from a stitch pattern") {
+	StitchPattern pattern;
+	pattern.add(0, 0, STITCH_NORMAL);
+	pattern.add(30, 40, STITCH_NORMAL);   // 50 units
+	pattern.add(30, 40, STITCH_COLOR);
+	pattern.add(500, 40, STITCH_JUMP);    // no thread
+	pattern.add(900, 40, STITCH_JUMP);
+	pattern.add(900, 140, STITCH_NORMAL); // 100 units
+	pattern.add(900, 140, STITCH_END);
+
+	MachineProfile profile;
+	profile.stitchesPerMinute = 3.0;
+	profile.trimSeconds = 30.0;
+	profile.colorChangeSeconds = 60.0;
+	profile.threadPerLength = 2.0;
+	profile.threadCostPerMeter = 100.0;
+	profile.machineCostPerHour = 60.0;
+	profile.travelMetersPerMinute = 0.087; // the 870-unit jump takes a minute
+
+	MachineEstimate e = MachineEstimator::estimate(pattern, profile);
+	CHECK(e.stitches == 3);
+	CHECK(e.trims == 1);
+	CHECK(e.colorChanges == 1);
+	REQUIRE(e.metersPerColor.size() == 2);
+	CHECK(e.metersPerColor[0] == doctest::Approx(0.01));
+	CHECK(e.metersPerColor[1] == doctest::Approx(0.02));
+	CHECK(e.threadCost == doctest::Approx(3.0));
+	CHECK(e.travelMeters == doctest::Approx(0.087));
+	CHECK(e.minutes == doctest::Approx(3.5));
+	CHECK(e.durationMinutes() == 4);
+	CHECK(e.totalCost() == doctest::Approx(6.5));
+
+	CommissionProject c("Logo", 0, HARD, "Client A", 0.0);
+	applyEstimate(c, e);
+	CHECK(c.getDuration() == 4);
+	CHECK(c.getCost() == doctest::Approx(6.5));
+
+	vector<MachineEstimate> all = MachineEstimator::estimateAll(vector<StitchPattern>(20, pattern), profile, 4);
+	CHECK(all.size() == 20);
+	CHECK(all[19].threadMeters == doctest::Approx(0.03));
+}
+
+// New Tests- Preview Rasterizer
+TEST_CASE("Preview renders anti-aliased stitches") {
+	StitchPattern pattern;
+	pattern.add(0, 0, STITCH_NORMAL);
+	pattern.add(100, 0, STITCH_NORMAL);
+	pattern.add(100, 0, STITCH_COLOR);
+	pattern.add(100, 100, STITCH_NORMAL);
+
+	PreviewOptions options;
+	options.size = 120;
+	options.margin = 10;
+	options.threadWidth = 3.0f;
+	options.numThreads = 1;
+	PreviewImage image = PatternRasterizer::render(pattern, options);
+	CHECK(image.width == 120);
+	CHECK(image.height == 120);
+
+	// First color along the bottom edge, second up the right side
+	const unsigned char* bottom = image.at(60, 110);
+	CHECK(bottom[0] == THREAD_COLORS[0][0]);
+	CHECK(bottom[2] == THREAD_COLORS[0][2]);
+	const unsigned char* right = image.at(110, 50);
+	CHECK(right[1] == THREAD_COLORS[1][1]);
+	CHECK(image.at(50, 50)[0] == (unsigned char)PREVIEW_BACKGROUND);
+	unsigned char edge = image.at(60, 111)[1]; // half covered
+	CHECK(edge > THREAD_COLORS[0][1]);
+	CHECK(edge < (unsigned char)PREVIEW_BACKGROUND);
+
+	options.numThreads = 4;
+	CHECK(PatternRasterizer::render(pattern, options).pixels == image.pixels);
+
+	OutputBuffer out;
+	writePPM(out, image);
+	CHECK(out.size() == 15 + 120 * 120 * 3);
+	CHECK(out.str().compare(0, 15, "P6\n120 120\n255\n") == 0);
+}
+
+// New Tests- Path Optimizer
+// Short horizontal run of stitches starting at (x, y)
+void addRun(StitchPattern& pattern, int x, int y, bool jump = true) {
+	if (jump) pattern.add(x, y, STITCH_JUMP);
+	for (int k = 0; k <= 2; k++) pattern.add(x + k * 10, y, STITCH_NORMAL);
+}
+
+TEST_CASE("Path optimizer shortens travel between blocks") {
+	StitchPattern pattern;
+	pattern.add(0, 0, STITCH_JUMP);
+	addRun(pattern, 0, 0, false);
+	addRun(pattern, 900, 0);
+	addRun(pattern, 300, 0);
+	addRun(pattern, 600, 0);
+	pattern.add(620, 0, STITCH_COLOR);
+	addRun(pattern, 0, 500);
+	pattern.add(0, 500, STITCH_END);
+
+	MachineProfile profile;
+	PathOptimization result = PathOptimizer::optimize(pattern, profile);
+	CHECK(result.travelBefore == doctest::Approx(880 + 620 + 280 + hypot(620, 500)));
+	CHECK(result.travelAfter == doctest::Approx(280 * 3 + hypot(900, 500)));
+	CHECK(result.after.stitches == result.before.stitches);
+	CHECK(result.after.threadMeters == doctest::Approx(result.before.threadMeters));
+	CHECK(result.after.colorChanges == 1);
+	CHECK(result.savedMinutes() > 0.0);
+
+	// Blocks are sewn left to right and the second color still comes last,
+	// sewn backwards so it starts closer
+	vector<int> starts;
+	for (size_t i = 0; i < result.pattern.size(); i++)
+		if (result.pattern.types[i] == STITCH_JUMP) starts.push_back(result.pattern.xs[i]);
+	CHECK(starts == vector<int>{ 300, 600, 900, 20 });
+	CHECK(result.pattern.ys[result.pattern.size() - 1] == 500);
+
+	PracticeProject project("Sampler", 30, EASY, 12, 5.0);
+	result.before.minutes = 10.0;
+	result.after.minutes = 7.5;
+	applyOptimization(project, result);
+	CHECK(project.getDuration() == 28);
+}
+
+TEST_CASE("Path optimizer reverses blocks when allowed") {
+	StitchPattern pattern;
+	addRun(pattern, 0, 0, false);   // ends at 20
+	addRun(pattern, 100, 0);        // 100 -> 120
+	addRun(pattern, 40, 0);         // 40 -> 60, best sewn after the first
+	pattern.add(60, 0, STITCH_END);
+
+	PathOptions keepDirection;
+	keepDirection.allowReverse = false;
+	PathOptimization forward = PathOptimizer::optimize(pattern, MachineProfile(), keepDirection);
+	CHECK(forward.travelAfter == doctest::Approx(20 + 40));
+
+	PathOptimization reversed = PathOptimizer::optimize(pattern, MachineProfile());
+	CHECK(reversed.travelAfter <= forward.travelAfter);
+	CHECK(reversed.after.stitches == 9);
+}
+
+TEST_CASE("Path optimizer keeps the stitch sewn from a jump landing") {
+	StitchPattern pattern;
+	pattern.add(0, 0, STITCH_NORMAL);
+	pattern.add(100, 0, STITCH_NORMAL);
+	pattern.add(500, 0, STITCH_JUMP);   // lands 10 units before the first stitch
+	pattern.add(510, 0, STITCH_NORMAL);
+	pattern.add(540, 30, STITCH_NORMAL);
+	pattern.add(200, 0, STITCH_JUMP);
+	pattern.add(205, 0, STITCH_NORMAL);
+	pattern.add(205, 0, STITCH_END);
+
+	MachineProfile profile;
+	MachineEstimate input = MachineEstimator::estimate(pattern, profile);
+	for (bool allowReverse : { false, true }) {
+		PathOptions options;
+		options.allowReverse = allowReverse;
+		PathOptimization result = PathOptimizer::optimize(pattern, profile, options);
+		CHECK(result.before.threadMeters == input.threadMeters);
+		CHECK(result.after.threadMeters == doctest::Approx(input.threadMeters));
+		CHECK(result.after.stitches == input.stitches);
+		CHECK(result.travelAfter < result.travelBefore);
+
+		bool landing = false;
+		for (size_t i = 0; i < result.pattern.size(); i++)
+			landing = landing || (result.pattern.xs[i] == 500 && result.pattern.ys[i] == 0);
+		CHECK(landing);
+	}
+}
+
+TEST_CASE("Path optimizer keeps every color change") {
+	StitchPattern pattern;
+	pattern.add(0, 0, STITCH_COLOR);    // before anything is sewn
+	addRun(pattern, 0, 0, false);
+	pattern.add(20, 0, STITCH_COLOR);
+	pattern.add(20, 0, STITCH_COLOR);   // a color with no stitches
+	addRun(pattern, 300, 0);
+	addRun(pattern, 100, 0);
+	pattern.add(120, 0, STITCH_COLOR);  // last color also empty
+	pattern.add(120, 0, STITCH_END);
+
+	MachineProfile profile;
+	for (bool reorderColors : { false, true }) {
+		PathOptions options;
+		options.reorderColors = reorderColors;
+		PathOptimization result = PathOptimizer::optimize(pattern, profile, options);
+		CHECK(result.before.colorChanges == 4);
+		CHECK(result.after.colorChanges == result.before.colorChanges);
+		CHECK(result.after.stitches == result.before.stitches);
+		CHECK(result.after.minutes <= result.before.minutes);
+	}
+}
+
+TEST_CASE("Path optimizer never returns a slower pattern") {
+	MachineProfile profile;
+	unsigned int seed = 12345;
+	auto next = [&](int range) {
+		seed = seed * 1103515245u + 12345u;
+		return (int)((seed >> 16) % (unsigned int)range);
+	};
+	for (int trial = 0; trial < 50; trial++) {
+		StitchPattern pattern;
+		int blocks = 1 + next(8);
+		for (int b = 0; b < blocks; b++) {
+			if (b > 0 && next(4) == 0) pattern.add(0, 0, STITCH_COLOR);
+			addRun(pattern, next(1000), next(1000), b > 0);
+		}
+		pattern.add(0, 0, STITCH_END);
+
+		PathOptions options;
+		options.reorderColors = (trial % 2) == 1;
+		PathOptimization result = PathOptimizer::optimize(pattern, profile, options);
+		CHECK(result.after.minutes <= result.before.minutes);
+		CHECK(result.travelAfter <= result.travelBefore);
+		CHECK(result.after.stitches == result.before.stitches);
+		CHECK(result.after.colorChanges == result.before.colorChanges);
+	}
+
+	// A single block has nothing to gain, so the input comes back as is
+	StitchPattern single;
+	addRun(single, 0, 0, false);
+	single.add(20, 0, STITCH_END);
+	PathOptimization result = PathOptimizer::optimize(single, profile);
+	CHECK(result.pattern.xs == single.xs);
+	CHECK(result.pattern.types == single.types);
+	CHECK(result.savedMinutes() == 0.0);
+}
+
+#elif defined(RUN_BENCHMARKS)
+#include <chrono>
+#include <memory>
+
+// Benchmarks
+template <typename Func>
+double timeMs(Func f) {
+	auto start = chrono::steady_clock::now();
+	f();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+	const int NUM_PROJECTS = 1000000;
+	ProjectCatalog catalog;
+	vector<unique_ptr<EmbroideryItem>> pointers;
+
+	for (int i = 0; i < NUM_PROJECTS; i++) {
+		DifficultyLevel d = (DifficultyLevel)(EASY + i % 3);
+		if (i % 2 == 0) {
+			catalog.add(PracticeProject("Practice", 30 + i % 60, d, 1000 + i % 5000, 5.0 + i % 20));
+			pointers.push_back(unique_ptr<EmbroideryItem>(new PracticeProject("Practice", 30 + i % 60, d, 1000 + i % 5000, 5.0 + i % 20)));
+		}
+		else {
+			catalog.add(CommissionProject("Logo", 60 + i % 90, d, "Client", 40.0 + i % 50));
+			pointers.push_back(unique_ptr<EmbroideryItem>(new CommissionProject("Logo", 60 + i % 90, d, "Client", 40.0 + i % 50)));
+		}
+	}
+
+	double flatCost = 0.0, pointerCost = 0.0;
+	long long flatDuration = 0, pointerDuration = 0;
+
+	double flatMs = timeMs([&]() {
+		catalog.forEach([&](const auto& item) {
+			using Item = typename decay<decltype(item)>::type;
+			flatCost += item.Item::getCost();
+			flatDuration += item.getDuration();
+		});
+	});
+	double pointerMs = timeMs([&]() {
+		for (const unique_ptr<EmbroideryItem>& item : pointers) {
+			pointerCost += item->getCost();
+			pointerDuration += item->getDuration();
+		}
+	});
+
+	cout << "Costing " << NUM_PROJECTS << " projects\n";
+	cout << left << setw(30) << "ProjectCatalog" << fixed << setprecision(2) << flatMs << " ms\n";
+	cout << left << setw(30) << "vector<unique_ptr>" << pointerMs << " ms\n";
+	cout << "Totals match: " << ((flatCost == pointerCost && flatDuration == pointerDuration) ? "yes" : "no") << "\n";
+
+	// Listing through OutputBuffer vs. the old iostream formatting
+	OutputBuffer buffer;
+	ostringstream stream;
+	double bufferMs = timeMs([&]() { catalog.writeListing(buffer); });
+	double streamMs = timeMs([&]() {
+		for (const unique_ptr<EmbroideryItem>& item : pointers) {
+			stream << "Name: " << item->getName()
+				<< ", Duration: " << item->getDuration()
+				<< ", Difficulty: " << difficultyToString(item->getDifficulty())
+				<< ", Cost: " << CostInfo(item->getCost()).formattedCost() << endl;
+		}
+	});
+
+	cout << "\nListing " << NUM_PROJECTS << " projects\n";
+	cout << left << setw(30) << "OutputBuffer" << fixed << setprecision(2) << bufferMs << " ms ("
+		<< buffer.size() / 1048576 << " MB)\n";
+	cout << left << setw(30) << "ostream + endl" << streamMs << " ms\n";
+
+	// DST decoding, fed in file-sized chunks
+	const int NUM_RECORDS = 20000000;
+	string dst(DST_HEADER_SIZE, ' ');
+	for (int i = 0; i < NUM_RECORDS; i++) {
+		dst += (char)(i & 0xFF);
+		dst += (char)((i >> 8) & 0x3F);
+		dst += (char)(i % 97 == 0 ? 0x83 : 0x03);
+	}
+	int parsedStitches = 0;
+	double parseMs = timeMs([&]() {
+		PatternParser parser(PATTERN_DST);
+		for (size_t pos = 0; pos < dst.size(); pos += PATTERN_CHUNK_SIZE)
+			parser.feed(dst.data() + pos, min(PATTERN_CHUNK_SIZE, dst.size() - pos));
+		string error;
+		parser.finish(error);
+		parsedStitches = parser.stats().stitches;
+	});
+
+	cout << "\nParsing " << dst.size() / 1048576 << " MB of DST records\n";
+	cout << left << setw(30) << "PatternParser" << fixed << setprecision(2) << parseMs << " ms ("
+		<< (dst.size() / 1048576.0) / (parseMs / 1000.0) << " MB/s, " << parsedStitches << " stitches)\n";
+
+	// Costing a batch of designs
+	const int NUM_DESIGNS = 2000;
+	vector<StitchPattern> designs(NUM_DESIGNS);
+	for (int d = 0; d < NUM_DESIGNS; d++) {
+		for (int i = 0; i < 10000; i++) {
+			StitchType type = (i % 2500 == 2499) ? STITCH_COLOR : (i % 300 == 0 ? STITCH_JUMP : STITCH_NORMAL);
+			designs[d].add((i * 7 + d) % 1000, (i * 13) % 800, type);
+		}
+	}
+	vector<MachineEstimate> estimates;
+	double estimateMs = timeMs([&]() { estimates = MachineEstimator::estimateAll(designs, MachineProfile()); });
+
+	cout << "\nEstimating " << NUM_DESIGNS << " designs of 10000 stitches\n";
+	cout << left << setw(30) << "MachineEstimator" << fixed << setprecision(2) << estimateMs << " ms ("
+		<< NUM_DESIGNS / (estimateMs / 1000.0) << " designs/s)\n";
+
+	// Preview of one large design
+	StitchPattern large;
+	for (int i = 0; i < 200000; i++)
+		large.add((int)(5000 + 4000 * cos(i * 0.013) * sin(i * 0.0007)), (int)(5000 + 4000 * sin(i * 0.017)), i % 50000 == 49999 ? STITCH_COLOR : STITCH_NORMAL);
+	PreviewOptions previewOptions;
+	previewOptions.size = 1024;
+	PreviewImage preview;
+	double renderMs = timeMs([&]() { preview = PatternRasterizer::render(large, previewOptions); });
+
+	cout << "\nRendering 200000 stitches at " << preview.width << "x" << preview.height << "\n";
+	cout << left << setw(30) << "PatternRasterizer" << fixed << setprecision(2) << renderMs << " ms\n";
+
+	// Reordering a design with scattered blocks
+	StitchPattern scattered;
+	unsigned int seed = 12345;
+	for (int b = 0; b < 20000; b++) {
+		if (b > 0 && b % 5000 == 0) scattered.add(scattered.xs.back(), scattered.ys.back(), STITCH_COLOR);
+		seed = seed * 1103515245 + 12345;
+		int bx = (int)(seed >> 16) % 10000;
+		seed = seed * 1103515245 + 12345;
+		int by = (int)(seed >> 16) % 10000;
+		scattered.add(bx, by, STITCH_JUMP);
+		for (int k = 0; k < 10; k++)
+			scattered.add(bx + k * 15, by + (k % 2) * 20, STITCH_NORMAL);
+	}
+	scattered.add(scattered.xs.back(), scattered.ys.back(), STITCH_END);
+	PathOptimization optimized;
+	double optimizeMs = timeMs([&]() { optimized = PathOptimizer::optimize(scattered, MachineProfile()); });
+
+	cout << "\nOptimizing 20000 blocks\n";
+	cout << left << setw(30) << "PathOptimizer" << fixed << setprecision(2) << optimizeMs << " ms (travel "
+		<< optimized.travelBefore * METERS_PER_UNIT << " m -> " << optimized.travelAfter * METERS_PER_UNIT << " m, saved "
+		<< optimized.savedMinutes() << " min)\n";
+	return 0;
 }
 
 #else
@@ -425,6 +6167,11 @@ int main() {
 	EmbroideryTracker tracker = EmbroideryTracker();
 	tracker.showBanner();
 
+	string rulesError;
+	if (!tracker.loadRulesFile("rules.txt", rulesError)) {
+		cout << "Could not load rules.txt (" << rulesError << "). Using default rules.\n";
+	}
+
 	string userName = tracker.getNonEmptyString("Enter your name: ");
 	double weeklyGoal = tracker.getPositiveDouble("Enter your weekly goal for embroidery hours: ");
 
@@ -443,7 +6190,7 @@ int main() {
 
 		switch (choice) {
 		case 1:
-			if (tracker.numSessions < MAX_SESSIONS) {
+			if (tracker.numSessions < tracker.getMaxSessions()) {
 				tracker.fillSession();
 			}
 			else {
@@ -456,46 +6203,105 @@ int main() {
 				cout << "No embroidery sessions recorded yet.\n";
 			}
 			else {
+				SortColumn column = SORT_HOURS;
+				bool sorted = tracker.getSortColumn(column);
+
 				cout << "\n" << userName << "'s Embroidery Sessions\n";
-				cout << left << setw(20) << "Description"
-					<< setw(10) << "Hours"
-					<< setw(10) << "Cost"
-					<< setw(15) << "Difficulty" << endl;
+				writeHeader(cout, SESSION_COLUMNS);
 
-				tracker.printAllSessions();
+				if (sorted)
+					tracker.printSortedSessions(column);
+				else
+					tracker.printAllSessions();
 			}
 			break;
 
 		case 3: {
-			double totalHours = tracker.calculateTotalHours();
-			double totalCost = tracker.calculateTotalCost();
+			// Only count sessions from the current week
+			long long now = (long long)time(nullptr);
+			RollupBucket week = tracker.getRollups().getWeek(now);
+			RollupBucket month = tracker.getRollups().getMonth(now);
 
 			cout << "\nRecommendation for " << userName << ":\n";
+			cout << "This week: " << fixed << setprecision(1) << week.hours
+				<< " of " << weeklyGoal << " hours, $" << setprecision(2) << week.cost << "\n";
+			cout << "This month: " << fixed << setprecision(1) << month.hours
+				<< " hours, $" << setprecision(2) << month.cost << "\n";
+			cout << tracker.getRecommendation(weeklyGoal, now) << "\n";
+			break;
+		}
+
+		case 4:
+			tracker.saveReport(userName, weeklyGoal);
+			cout << "Report saved to report.txt\n";
+			break;
 
-			if (totalHours >= weeklyGoal && totalCost <= MAX_COST_GOOD) {
-				cout << "Great job! You met your weekly goal AND stayed on budget.\n";
+		case 5: {
+			string query = tracker.getNonEmptyString("Search for: ");
+			vector<unsigned int> rows = tracker.searchSessions(query);
+
+			if (rows.empty()) {
+				cout << "No sessions match \"" << query << "\".\n";
+			}
+			else {
+				tracker.printSessions(rows);
+				SessionTotals totals = tracker.calculateTotalsFor(rows);
+				cout << totals.count << " matching sessions, "
+					<< fixed << setprecision(1) << totals.hours << " hours, $"
+					<< setprecision(2) << totals.cost << "\n";
 			}
-			else if (totalHours < weeklyGoal && totalCost > MAX_COST_GOOD) {
-				cout << "You may want shorter sessions or lower-cost projects.\n";
+			break;
+		}
+
+		case 6: {
+			string query = tracker.getNonEmptyString("Query (e.g. WHERE cost>50 GROUP BY difficulty SUM(hours)): ");
+			QueryResult result;
+			string error;
+
+			if (tracker.runQuery(query, result, error)) {
+				tracker.printQueryResult(result);
 			}
 			else {
-				cout << "You are making steady progress. Keep going!\n";
+				cout << "Invalid query: " << error << "\n";
 			}
 			break;
 		}
 
-		case 4:
-			tracker.saveReport(userName, weeklyGoal);
-			cout << "Report saved to report.txt\n";
+		case 7:
+			cout << "\n" << userName << "'s Statistics\n";
+			writeStats(cout, tracker.computeStats());
+			cout << "Hours p50/p90/p99: " << fixed << setprecision(1)
+				<< tracker.getHoursSketch().quantile(0.5) << " / "
+				<< tracker.getHoursSketch().quantile(0.9) << " / "
+				<< tracker.getHoursSketch().quantile(0.99) << "\n";
+			cout << "Cost p50/p90/p99: $" << setprecision(2)
+				<< tracker.getCostSketch().quantile(0.5) << " / $"
+				<< tracker.getCostSketch().quantile(0.9) << " / $"
+				<< tracker.getCostSketch().quantile(0.99) << "\n";
+			break;
+
+		case 8:
+			if (tracker.numSessions == 0) {
+				cout << "No embroidery sessions recorded yet.\n";
+			}
+			else {
+				cout << "\nMost Expensive Sessions\n";
+				for (const Session& s : tracker.getTopByCost().getSorted())
+					tracker.printSessionRow(s);
+
+				cout << "\nLongest Sessions\n";
+				for (const Session& s : tracker.getTopByHours().getSorted())
+					tracker.printSessionRow(s);
+			}
 			break;
 
-		case 5:
+		case 9:
 			cout << "Goodbye, " << userName << "!\n";
 			break;
 
 		}
 
-	} while (choice != 5);
+	} while (choice != 9);
 
 	return 0;
 